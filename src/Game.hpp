@@ -7,16 +7,38 @@
 #include <ftxui/dom/canvas.hpp>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
 #include <string>
-#include <thread>
+#include <vector>
 
 #include "audio.hpp"
 #include "constants.hpp"
+#include "frame_output.hpp"
+#include "frame_scheduler.hpp"
+#include "game_clock.hpp"
+#include "leaderboard.hpp"
+#include "library.hpp"
+#include "library_analysis.hpp"
+#include "map_journal.hpp"
+#include "play_field.hpp"
+#include "replay.hpp"
+#include "settings.hpp"
+#include "simulation.hpp"
+#include "song_filter.hpp"
+#include "song_search.hpp"
 #include "song.hpp"
+#include "spsc_queue.hpp"
+#include "startup_profile.hpp"
+#include "trace.hpp"
 #include "types.hpp"
 #include "utils.hpp"
+#include "virtual_list.hpp"
 
 class Game
 {
@@ -31,50 +53,270 @@ class Game
     SaveSongData
   };
 
-  static constexpr auto TIMING = std::chrono::milliseconds(1000 / 120);
   ftxui::ScreenInteractive screen = ftxui::ScreenInteractive::TerminalOutput();
 
   GameState state = GameState::MainMenu;
+  SongLibrary library;
   Song song;
   Score score{};
-  std::chrono::steady_clock::time_point timepoint;
+  Leaderboard leaderboard;
+  std::size_t score_rank = 0;
+  std::size_t score_plays = 0;
+  std::vector<ScoreEntry> top_scores;
+  bool replay_saved = true;
+  Settings settings;
+  FrameOutput output{ std::cout, settings.output_mode == OutputMode::Damage };
+  FrameScheduler frames{ [this] { screen.PostEvent(ftxui::Event::Custom); }, settings.target_fps };
+  GameClock clock;
+  ClickQueue clicks;
+  MapJournal journal;
+  bool song_saved = false;
+  std::unique_ptr<Simulation> simulation;
+  PlayField play_field;
+  ftxui::Element play_view;
+  Score shown_score{};
+  const char *shown_hit = nullptr;
+  ftxui::Element overlay;
+  std::chrono::steady_clock::time_point overlay_updated;
   std::string last_hit;
-
-  ftxui::Component inputs = ftxui::Container::Vertical({});
-  ftxui::Component render = ftxui::Container::Vertical({});
-  Audio audio_player;
+  std::string audio_path;
+  std::string prefetched_stem;
+  bool song_started = false;
+
+  SongSearchIndex search_index;
+  std::size_t indexed_revision = 0;
+  std::string search_query;
+  LibraryAnalysis analysis;
+  std::vector<std::string> sort_labels{ "relevance", "length", "notes", "density", "jump" };
+  int sort_order = 0;
+  // search results that pass the stat filters of the query, in the chosen order
+  std::vector<std::uint32_t> shown;
+  // rows are read straight from the library entries they point at
+  ftxui::Component song_list = std::make_shared<VirtualList>(
+    [&] { return shown.size(); },
+    [&](std::size_t i) { return song_label(search_result(i)); },
+    [&](std::size_t i) { play_song(search_result(i).stem); },
+    [&](std::size_t i) { prefetch_song(search_result(i).stem); });
+  int active_view = 0;
+  ftxui::Component views = ftxui::Container::Tab({}, &active_view);
+  // opened on first use, so browsing the menus or quitting never waits for the audio device
+  std::unique_ptr<Audio> audio_device;
+  bool library_ready = false;
+  bool leaderboard_ready = false;
+  StartupProfile *startup_profile = nullptr;
 
 private:
-  std::function<void()> load_song(const std::string &s)
+  Audio &audio_player()
   {
-    return [&, s] {
-      song = load_song_from_disk(s);
-      score = {};
-      timepoint = std::chrono::steady_clock::now();
-      game_iteration(GameState::Play);
-    };
+    if (!audio_device) {
+      TRACE_SCOPE("audio device");
+      audio_device = std::make_unique<Audio>(settings.audio_cache_mb * AUDIO_CONSTANTS::BYTES_PER_MB);
+      audio_device->set_mode(settings.playback_mode);
+      audio_device->set_hitsound_volume(settings.hitsound_volume);
+    }
+    return *audio_device;
+  }
+  // Recovers interrupted recordings and reads the library index the first time a screen needs the songs.
+  void prepare_library()
+  {
+    if (library_ready) { return; }
+    TRACE_SCOPE("library setup");
+    recover_journals();
+    library.load();
+    library.refresh();
+    library_ready = true;
+  }
+  const LibraryEntry &search_result(const std::size_t i) const { return library.songs()[shown[i]]; }
+  static std::string song_label(const LibraryEntry &entry)
+  {
+    const auto &stats = entry.stats;
+    if (!stats.analyzed) { return entry.stem; }
+    const auto seconds = stats.duration_ms / 1000;
+    return fmt::format("{:<30} {:>2}:{:02} {:>5} notes {:>3.0f} nps", entry.stem, seconds / 60, seconds % 60,
+      stats.note_count, stats.peak_notes_per_second);
+  }
+  void update_song_view()
+  {
+    const auto query = parse_song_query(search_query);
+    filter_and_sort(library.songs(), search_index.search(query.text), query, static_cast<SongSort>(sort_order), shown);
+  }
+  void play_song(const std::string &stem)
+  {
+    song = load_song_from_disk(stem);
+    score = {};
+    game_iteration(GameState::Play);
+  }
+  static std::string audio_file_path(const std::string &stem, const std::string &file)
+  {
+    return fmt::format("{}/{}/{}", FILE_CONSTANTS::FOLDER_PATH, stem, file);
+  }
+  void prefetch_song(const std::string &stem)
+  {
+    if (stem == prefetched_stem) { return; }
+    prefetched_stem = stem;
+    if (const auto *entry = library.find(stem); entry != nullptr && !entry->audio_file.empty()) {
+      audio_player().prefetch(audio_file_path(stem, entry->audio_file));
+    }
   }
   void initialize_song()
   {
-    if (const std::string p = find_song(song); !p.empty()) {
-      audio_player.init_song(fmt::format("{}/{}/{}", FILE_CONSTANTS::FOLDER_PATH, song.name, p));
+    prepare_library();
+    const auto *entry = library.find(song.name);
+    if (entry == nullptr || entry->audio_file.empty()) { entry = &library.update(song.name); }
+    audio_path = entry->audio_file.empty() ? std::string{} : audio_file_path(song.name, entry->audio_file);
+    song_started = false;
+    audio_player().prefetch(audio_path);
+  }
+  // The timeline follows the music, which starts once its buffer has been decoded in the background.
+  bool start_song_when_ready()
+  {
+    if (!song_started && audio_player().is_ready(audio_path)) {
+      audio_player().init_song(audio_path);
+      clock.reset(settings.audio_offset_ms);
+      clicks.clear();
+      song_started = true;
+      if (state == GameState::Play) {
+        simulation = std::make_unique<Simulation>(
+          song.notes,
+          clicks,
+          [&] { return song_time(); },
+          [&] { return audio_player().has_ended(); },
+          [&] { screen.PostEvent(ftxui::Event::Custom); },
+          [&](const Points &points) { audio_player().play_hitsound(hit_sound_for(points)); });
+      }
+    }
+    return song_started;
+  }
+  long long song_time() { return clock.now(audio_player().position_ms()); }
+
+  // Keeps the play as a replay with the score the simulation reported, so consu_verify can check it headlessly.
+  void finish_play()
+  {
+    const auto snapshot = simulation->snapshot();
+    score = snapshot.score;
+    last_hit = snapshot.last_hit;
+
+    const auto recorded_at = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+    replay_saved = save_replay(Replay{ song.name, score, snapshot.time_ms, simulation->clicks_judged() },
+      generate_replay_path(song.name, recorded_at.count()));
+    if (!leaderboard_ready) {
+      leaderboard.load();
+      leaderboard_ready = true;
+    }
+    leaderboard.add(song.name, score, recorded_at.count());
+    score_rank = leaderboard.rank(song.name, score.points);
+    score_plays = leaderboard.count(song.name);
+    top_scores = leaderboard.top(song.name, SCORE_CONSTANTS::TOP_SHOWN);
+    game_iteration(GameState::Scoreboard);
+  }
+
+  // Stamps clicks with the song time as soon as they reach the component tree, before any state handles them.
+  // FTXUI reads the terminal on its own thread without a hook for us, so this is dispatch time, not read time:
+  // a click that arrives while a frame is being drawn is stamped once that frame is done.
+  void capture_click(ftxui::Event &ev)
+  {
+    if (!song_started || (state != GameState::Play && state != GameState::CreateSongData)) { return; }
+    if (ev.is_mouse() && ev.mouse().button == ftxui::Mouse::Left && ev.mouse().motion == ftxui::Mouse::Pressed) {
+      clicks.capture(ev.mouse().x, ev.mouse().y, [&] { return song_time(); });
     }
   }
+  void record_clicks()
+  {
+    TimedClick click{};
+    while (clicks.pop(click)) {
+      song.notes.push_back({ click.x, click.y, click.time_ms });
+      journal.append(song.notes.back());
+    }
+  }
+  ftxui::Element frame_stats() const
+  {
+    if (!settings.show_frame_stats) { return ftxui::emptyElement(); }
+    const auto stats = frames.stats();
+    const auto &written = output.stats();
+    return ftxui::vbox({ ftxui::text(" "),
+      ftxui::text(fmt::format("FPS: {:.0f} (avg {:.1f} ms, worst {:.1f} ms, {} late)",
+        stats.fps,
+        stats.average_ms,
+        stats.worst_ms,
+        stats.late_frames)),
+      ftxui::text(fmt::format("Output: {} B/frame ({} B/frame avg, {} full)",
+        written.last_frame_bytes,
+        written.frames > 0 ? written.total_bytes / written.frames : 0,
+        written.full_frames)) });
+  }
+  // Percentiles over the trace rings, recomputed a few times per second rather than every frame.
+  ftxui::Element trace_overlay()
+  {
+    if (!settings.show_trace_overlay) { return ftxui::emptyElement(); }
+    const auto now = std::chrono::steady_clock::now();
+    if (overlay && now - overlay_updated < TRACE_CONSTANTS::OVERLAY_REFRESH) { return overlay; }
+    overlay_updated = now;
+
+    const auto line = [](const char *label, const LatencyPercentiles &p) {
+      return ftxui::text(
+        fmt::format("{}: p50 {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms", label, p.p50_ms, p.p95_ms, p.p99_ms));
+    };
+    overlay = ftxui::vbox({ ftxui::text(" "),
+      line("Frame", Trace::percentiles("frame")),
+      line("Input to judgement", Trace::percentiles("input latency")) });
+    return overlay;
+  }
+  ftxui::Element loading_screen() const
+  {
+    return ftxui::hbox({ ftxui::text(fmt::format("Loading {}...", song.name)) | ftxui::border });
+  }
+
+  // ASCII-art title centered above a screen; built once and shared by every frame that shows it.
+  static ftxui::Element banner(std::initializer_list<const char *> lines)
+  {
+    ftxui::Elements rows;
+    for (const auto *line : lines) { rows.push_back(ftxui::text(line)); }
+    return ftxui::hbox({ ftxui::filler(), ftxui::vbox(std::move(rows)), ftxui::filler() });
+  }
+
+  const ftxui::Element title_banner = banner({ R"(  _____ ____  _   _  _____ _    _)",
+    R"( / ____/ __ \| \ | |/ ____| |  | |)",
+    R"(| |   | |  | |  \| | (___ | |  | |)",
+    R"(| |   | |  | | . ` |\___ \| |  | |)",
+    R"(| |___| |__| | |\  |____) | |__| |)",
+    R"( \_____\____/|_| \_|_____/ \____/)" });
+  const ftxui::Element songs_banner = banner({ R"(  _____                                                    )",
+    R"( / ____|                                                   )",
+    R"(| (___   ___  _ __   __ _ ___   _ __ ___   ___ _ __  _   _ )",
+    R"( \___ \ / _ \| '_ \ / _` / __| | '_ ` _ \ / _ \ '_ \| | | |)",
+    R"( ____) | (_) | | | | (_| \__ \ | | | | | |  __/ | | | |_| |)",
+    R"(|_____/ \___/|_| |_|\__, |___/ |_| |_| |_|\___|_| |_|\__,_|)",
+    R"(                     __/ |                                 )",
+    R"(                    |___/                                  )" });
+  const ftxui::Element score_banner =
+    banner({ R"(   _____                            _         _       _   _                 )",
+      R"(  / ____|                          | |       | |     | | (_)                )",
+      R"( | |     ___  _ __   __ _ _ __ __ _| |_ _   _| | __ _| |_ _  ___  _ __  ___ )",
+      R"( | |    / _ \| '_ \ / _` | '__/ _` | __| | | | |/ _` | __| |/ _ \| '_ \/ __|)",
+      R"( | |___| (_) | | | | (_| | | | (_| | |_| |_| | | (_| | |_| | (_) | | | \__ \)",
+      R"(  \_____\___/|_| |_|\__, |_|  \__,_|\__|\__,_|_|\__,_|\__|_|\___/|_| |_|___/)",
+      R"(                     __/ |                                                  )",
+      R"(                    |___/                                                   )" });
+  const ftxui::Element new_song_banner =
+    banner({ R"(             _     _                                               )",
+      R"(    /\      | |   | |                                              )",
+      R"(   /  \   __| | __| |  _ __   _____      __  ___  ___  _ __   __ _ )",
+      R"(  / /\ \ / _` |/ _` | | '_ \ / _ \ \ /\ / / / __|/ _ \| '_ \ / _` |)",
+      R"( / ____ \ (_| | (_| | | | | |  __/\ V  V /  \__ \ (_) | | | | (_| |)",
+      R"(/_/    \_\__,_|\__,_| |_| |_|\___| \_/\_/   |___/\___/|_| |_|\__, |)",
+      R"(                                                              __/ |)",
+      R"(                                                             |___/ )" });
 
   ftxui::Component main_menu()
   {
-    inputs->Add(ftxui::Button(std::string("Songs menu"), [&] { game_iteration(GameState::SongsMenu); }));
-    inputs->Add(ftxui::Button(std::string("Create song"), [&] { game_iteration(GameState::CreateSongMetadata); }));
-
-    return ftxui::Renderer([&] {
-      return ftxui::vbox({ ftxui::hbox({ ftxui::filler(),
-                             ftxui::vbox({ ftxui::text(R"(  _____ ____  _   _  _____ _    _)"),
-                               ftxui::text(R"( / ____/ __ \| \ | |/ ____| |  | |)"),
-                               ftxui::text(R"(| |   | |  | |  \| | (___ | |  | |)"),
-                               ftxui::text(R"(| |   | |  | | . ` |\___ \| |  | |)"),
-                               ftxui::text(R"(| |___| |__| | |\  |____) | |__| |)"),
-                               ftxui::text(R"( \_____\____/|_| \_|_____/ \____/)") }),
-                             ftxui::filler() }),
+    auto inputs = ftxui::Container::Vertical({
+      ftxui::Button(std::string("Songs menu"), [&] { game_iteration(GameState::SongsMenu); }),
+      ftxui::Button(std::string("Create song"), [&] { game_iteration(GameState::CreateSongMetadata); }),
+    });
+
+    return ftxui::Renderer(inputs, [&, inputs] {
+      return ftxui::vbox({ title_banner,
         ftxui::text(" "),
         ftxui::hbox({ ftxui::filler(), ftxui::vbox({ inputs->Render() }), ftxui::filler() }) });
     });
@@ -82,96 +324,97 @@ private:
 
   ftxui::Component songs_menu()
   {
-    auto container = ftxui::Renderer([] { return ftxui::text(""); });
-    auto event_handler = ftxui::CatchEvent(container, [&](ftxui::Event ev) {
-      if (ev == ftxui::Event::Escape) { game_iteration(GameState::MainMenu); }
-      return false;
-    });
-
-    inputs->Add(event_handler);
-
-    const auto stems = get_songs_list();
-    for (const auto &stem : stems) { inputs->Add(ftxui::Button(stem, load_song(stem))); }
-
-    return ftxui::Renderer([&] {
-      return ftxui::vbox({ ftxui::hbox({ ftxui::filler(),
-                             ftxui::vbox({
-                               ftxui::text(R"(  _____                                                    )"),
-                               ftxui::text(R"( / ____|                                                   )"),
-                               ftxui::text(R"(| (___   ___  _ __   __ _ ___   _ __ ___   ___ _ __  _   _ )"),
-                               ftxui::text(R"( \___ \ / _ \| '_ \ / _` / __| | '_ ` _ \ / _ \ '_ \| | | |)"),
-                               ftxui::text(R"( ____) | (_) | | | | (_| \__ \ | | | | | |  __/ | | | |_| |)"),
-                               ftxui::text(R"(|_____/ \___/|_| |_|\__, |___/ |_| |_| |_|\___|_| |_|\__,_|)"),
-                               ftxui::text(R"(                     __/ |                                 )"),
-                               ftxui::text(R"(                    |___/                                  )"),
-                             }),
-                             ftxui::filler() }),
+    ftxui::InputOption search_option;
+    search_option.on_change = [&] { update_song_view(); };
+    search_option.on_enter = [&] {
+      if (!shown.empty()) { play_song(search_result(0).stem); }
+    };
+    auto search_box = ftxui::Input(&search_query, "type to search, e.g. nps<6 len>=90", search_option);
+    ftxui::ToggleOption sort_option;
+    sort_option.on_change = [&] { update_song_view(); };
+    auto sort_toggle = ftxui::Toggle(&sort_labels, &sort_order, sort_option);
+    auto inputs = ftxui::Container::Vertical({ search_box, sort_toggle, song_list });
+
+    auto view = ftxui::Renderer(inputs, [&, search_box, sort_toggle] {
+      if (analysis.apply(library)) { update_song_view(); }
+      return ftxui::vbox({ songs_banner,
         ftxui::text(" "),
         ftxui::hbox({ ftxui::filler(),
-          ftxui::vbox(
-            { inputs->Render() | ftxui::vscroll_indicator | ftxui::frame | ftxui::border
-              | ftxui::size(ftxui::WIDTH, ftxui::EQUAL, 60) | ftxui::size(ftxui::HEIGHT, ftxui::GREATER_THAN, 20) }),
+          ftxui::vbox({ ftxui::hbox({ ftxui::text("Search: "), search_box->Render() }) | ftxui::border,
+            ftxui::hbox({ ftxui::text("Sort by: "), sort_toggle->Render() }),
+            song_list->Render() | ftxui::border,
+            ftxui::text(fmt::format("{} of {} songs{}",
+              shown.size(),
+              library.songs().size(),
+              analysis.running() ? ", analysing maps" : "")) })
+            | ftxui::size(ftxui::WIDTH, ftxui::EQUAL, 60),
           ftxui::filler() }) });
     });
+    return ftxui::CatchEvent(view, [&](ftxui::Event ev) {
+      if (ev == ftxui::Event::Escape) { game_iteration(GameState::MainMenu); }
+      return false;
+    });
   }
 
-  ftxui::Component play_game()
+  void enter_songs_menu()
   {
-    initialize_song();
+    if (library_ready) {
+      library.refresh();
+    } else {
+      prepare_library();
+    }
+    if (indexed_revision != library.revision()) {
+      indexed_revision = library.revision();
+      search_index.build(library.songs());
+    }
+    analysis.start(library, [&] { screen.PostEvent(ftxui::Event::Custom); });
+    update_song_view();
+  }
 
-    auto container = ftxui::Renderer([] { return ftxui::text(""); });
-    auto event_handler = ftxui::CatchEvent(container, [&](ftxui::Event ev) {
-      if (ev.mouse().button == ftxui::Mouse::Left && ev.mouse().motion == ftxui::Mouse::Pressed) {
-        if (score.note_no + 1 != song.notes.size()) {
-          const auto now = std::chrono::steady_clock::now();
-          const auto &note = song.notes.at(score.note_no);
-          if (std::hypot(note.x - ev.mouse().x, note.y - ev.mouse().y) <= CANVAS_CONSTANTS::CIRCLE_DIAMETER) {
-            const auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now - timepoint).count();
-            const auto time_to_click = note.timestamp - timestamp;
-            const auto [point, msg] = time_to_points(time_to_click);
-            if (point == POINT_CONSTANTS::MISS.point) {
-              score.combo = 0;
-            } else {
-              ++score.combo;
-              score.max_combo = std::max(score.combo, score.max_combo);
-              score.points += point;
-            }
-            last_hit = msg;
-            ++score.note_no;
-          }
-        }
+  ftxui::Component play_game()
+  {
+    auto view = ftxui::Renderer([&] {
+      TRACE_SCOPE("play_game render");
+      if (!start_song_when_ready()) { return loading_screen(); }
+      const auto snapshot = simulation->snapshot();
+      play_field.update(song.notes, snapshot.judged, snapshot.time_ms);
+
+      // the sidebar is only rebuilt when something on it changed
+      if (!play_view || snapshot.score != shown_score || snapshot.last_hit != shown_hit || settings.show_frame_stats
+          || settings.show_trace_overlay) {
+        shown_score = snapshot.score;
+        shown_hit = snapshot.last_hit;
+        play_view = ftxui::hbox({ play_field.render(),
+          play_sidebar(song.name, shown_score, shown_hit, ftxui::vbox({ frame_stats(), trace_overlay() })) });
       }
+      return play_view;
+    });
+    return ftxui::CatchEvent(view, [&](ftxui::Event /*ev*/) {
+      if (simulation && simulation->snapshot().finished) { finish_play(); }
       return false;
     });
+  }
+  void enter_play()
+  {
+    initialize_song();
+    play_field.clear();
+    play_view = nullptr;
+  }
 
-    inputs->Add(event_handler);
-
-    return ftxui::Renderer([&] {
-      if (audio_player.has_ended()) { game_iteration(GameState::Scoreboard); }
-      ftxui::Canvas c = ftxui::Canvas(CANVAS_CONSTANTS::SIZE, CANVAS_CONSTANTS::SIZE);
-      const auto last_note = std::min(score.note_no + CANVAS_CONSTANTS::NOTES_ON_SCREEN_LIMIT, song.notes.size());
-      const auto now = std::chrono::steady_clock::now();
-      const auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now - timepoint).count();
-      for (auto n = score.note_no; n < last_note; ++n) {
-        const auto time_to_click = song.notes.at(n).timestamp - timestamp;
-        if (time_to_click > TIME_CONSTANTS::MAX_TIME_DISPLAY_NOTE) { break; }
-        if (time_to_click < 0) {
-          if (score.note_no + 1 != song.notes.size()) {
-            last_hit = POINT_CONSTANTS::MISS_TXT;
-            ++score.note_no;
-            score.combo = 0;
-          }
-        } else {
-          c.DrawPointCircle(song.notes.at(n).x * CANVAS_CONSTANTS::RATIO_FIX[0],
-            song.notes.at(n).y * CANVAS_CONSTANTS::RATIO_FIX[1],
-            CANVAS_CONSTANTS::CIRCLE_DIAMETER,
-            time_to_color(time_to_click));
-        }
-      }
+  ftxui::Component display_end_score()
+  {
+    auto inputs = ftxui::Container::Vertical({
+      ftxui::Button(std::string("Back to menu"), [&] { game_iteration(GameState::MainMenu); }),
+    });
 
-      return ftxui::hbox({ ftxui::canvas(std::move(c)) | ftxui::border,
-        ftxui::vbox({
-          ftxui::text(fmt::format("SONG NAME: {}", song.name)),
+    return ftxui::Renderer(inputs, [&, inputs] {
+      ftxui::Elements best;
+      for (std::size_t i = 0; i < top_scores.size(); ++i) {
+        best.push_back(ftxui::text(
+          fmt::format("{:>3}. {:>10} points  {:>5} max combo", i + 1, top_scores[i].points, top_scores[i].max_combo)));
+      }
+      return ftxui::vbox({ score_banner,
+        ftxui::vbox({ ftxui::text(fmt::format("SONG NAME: {}", song.name)),
           ftxui::text(" "),
           ftxui::text(fmt::format("POINTS: {}", score.points)),
           ftxui::text(" "),
@@ -180,65 +423,27 @@ private:
           ftxui::text(fmt::format("CURRENT COMBO: {}", score.combo)),
           ftxui::text(" "),
           ftxui::text(fmt::format("MAX COMBO: {}", score.max_combo)),
-        }) });
+          ftxui::text(" "),
+          ftxui::text(fmt::format("RANK: {} OF {} PLAYS", score_rank, score_plays)),
+          ftxui::vbox(std::move(best)),
+          ftxui::text(" "),
+          replay_saved ? ftxui::emptyElement() : ftxui::text("The replay of this play could not be saved."),
+          inputs->Render() | ftxui::size(ftxui::WIDTH, ftxui::EQUAL, 60) }) });
     });
   }
 
-  ftxui::Component display_end_score()
+  ftxui::Component create_song_metadata()
   {
-    inputs->Add(ftxui::Button(std::string("Back to menu"), [&] { game_iteration(GameState::MainMenu); }));
-
-    return ftxui::Renderer([&] {
-      return ftxui::vbox(
-        { ftxui::hbox({ ftxui::filler(),
-            ftxui::vbox({
-              ftxui::text(R"(   _____                            _         _       _   _                 )"),
-              ftxui::text(R"(  / ____|                          | |       | |     | | (_)                )"),
-              ftxui::text(R"( | |     ___  _ __   __ _ _ __ __ _| |_ _   _| | __ _| |_ _  ___  _ __  ___ )"),
-              ftxui::text(R"( | |    / _ \| '_ \ / _` | '__/ _` | __| | | | |/ _` | __| |/ _ \| '_ \/ __|)"),
-              ftxui::text(R"( | |___| (_) | | | | (_| | | | (_| | |_| |_| | | (_| | |_| | (_) | | | \__ \)"),
-              ftxui::text(R"(  \_____\___/|_| |_|\__, |_|  \__,_|\__|\__,_|_|\__,_|\__|_|\___/|_| |_|___/)"),
-              ftxui::text(R"(                     __/ |                                                  )"),
-              ftxui::text(R"(                    |___/                                                   )"),
-            }),
-            ftxui::filler() }),
-          ftxui::vbox({ ftxui::text(fmt::format("SONG NAME: {}", song.name)),
-            ftxui::text(" "),
-            ftxui::text(fmt::format("POINTS: {}", score.points)),
-            ftxui::text(" "),
-            ftxui::text(fmt::format("LAST HIT: {}", last_hit)),
-            ftxui::text(" "),
-            ftxui::text(fmt::format("CURRENT COMBO: {}", score.combo)),
-            ftxui::text(" "),
-            ftxui::text(fmt::format("MAX COMBO: {}", score.max_combo)),
-            ftxui::text(" "),
-            inputs->Render() | ftxui::size(ftxui::WIDTH, ftxui::EQUAL, 60) }) });
+    auto inputs = ftxui::Container::Vertical({
+      ftxui::Input(&song.name, "song name"),
+      ftxui::Renderer([] { return ftxui::text(" "); }),
+      ftxui::Button(std::string("Create song"), [&] { game_iteration(GameState::CreateSongMetadata2); }),
+      ftxui::Renderer([] { return ftxui::text(" "); }),
+      ftxui::Button(std::string("Back to menu"), [&] { game_iteration(GameState::MainMenu); }),
     });
-  }
 
-  ftxui::Component create_song_metadata()
-  {
-    song = Song{};
-
-    inputs->Add(ftxui::Input(&song.name, "song name"));
-    inputs->Add(ftxui::Renderer([] { return ftxui::text(" "); }));
-    inputs->Add(ftxui::Button(std::string("Create song"), [&] { game_iteration(GameState::CreateSongMetadata2); }));
-    inputs->Add(ftxui::Renderer([] { return ftxui::text(" "); }));
-    inputs->Add(ftxui::Button(std::string("Back to menu"), [&] { game_iteration(GameState::MainMenu); }));
-
-    return ftxui::Renderer([&] {
-      return ftxui::vbox({ ftxui::hbox({ ftxui::filler(),
-                             ftxui::vbox({
-                               ftxui::text(R"(             _     _                                               )"),
-                               ftxui::text(R"(    /\      | |   | |                                              )"),
-                               ftxui::text(R"(   /  \   __| | __| |  _ __   _____      __  ___  ___  _ __   __ _ )"),
-                               ftxui::text(R"(  / /\ \ / _` |/ _` | | '_ \ / _ \ \ /\ / / / __|/ _ \| '_ \ / _` |)"),
-                               ftxui::text(R"( / ____ \ (_| | (_| | | | | |  __/\ V  V /  \__ \ (_) | | | | (_| |)"),
-                               ftxui::text(R"(/_/    \_\__,_|\__,_| |_| |_|\___| \_/\_/   |___/\___/|_| |_|\__, |)"),
-                               ftxui::text(R"(                                                              __/ |)"),
-                               ftxui::text(R"(                                                             |___/ )"),
-                             }),
-                             ftxui::filler() }),
+    return ftxui::Renderer(inputs, [&, inputs] {
+      return ftxui::vbox({ new_song_banner,
         ftxui::text(" "),
         ftxui::hbox({ ftxui::filler(),
           ftxui::vbox({ inputs->Render() | ftxui::size(ftxui::WIDTH, ftxui::EQUAL, 60) }),
@@ -247,22 +452,12 @@ private:
   }
   ftxui::Component create_song_metadata2()
   {
-    std::filesystem::create_directories(generate_folder_path(song.name));
-
-    inputs->Add(ftxui::Button(std::string("Create song"), [&] { game_iteration(GameState::CreateSongData); }));
-    return ftxui::Renderer([&] {
-      return ftxui::vbox({ ftxui::hbox({ ftxui::filler(),
-                             ftxui::vbox({
-                               ftxui::text(R"(             _     _                                               )"),
-                               ftxui::text(R"(    /\      | |   | |                                              )"),
-                               ftxui::text(R"(   /  \   __| | __| |  _ __   _____      __  ___  ___  _ __   __ _ )"),
-                               ftxui::text(R"(  / /\ \ / _` |/ _` | | '_ \ / _ \ \ /\ / / / __|/ _ \| '_ \ / _` |)"),
-                               ftxui::text(R"( / ____ \ (_| | (_| | | | | |  __/\ V  V /  \__ \ (_) | | | | (_| |)"),
-                               ftxui::text(R"(/_/    \_\__,_|\__,_| |_| |_|\___| \_/\_/   |___/\___/|_| |_|\__, |)"),
-                               ftxui::text(R"(                                                              __/ |)"),
-                               ftxui::text(R"(                                                             |___/ )"),
-                             }),
-                             ftxui::filler() }),
+    auto inputs = ftxui::Container::Vertical({
+      ftxui::Button(std::string("Create song"), [&] { game_iteration(GameState::CreateSongData); }),
+    });
+
+    return ftxui::Renderer(inputs, [&, inputs] {
+      return ftxui::vbox({ new_song_banner,
         ftxui::text(" "),
         ftxui::hbox({ ftxui::filler(),
           ftxui::vbox({ ftxui::hbox({ ftxui::text("Folder has been created in: "),
@@ -276,62 +471,76 @@ private:
   }
   ftxui::Component create_song()
   {
-    initialize_song();
-    timepoint = std::chrono::steady_clock::now();
-
-    auto container = ftxui::Container::Vertical({});
-    auto event_handler = ftxui::CatchEvent(container, [&](ftxui::Event ev) {
-      if (audio_player.has_ended()) { game_iteration(GameState::SaveSongData); }
-      if (ev.mouse().button == ftxui::Mouse::Left && ev.mouse().motion == ftxui::Mouse::Pressed) {
-        song.notes.push_back({ ev.mouse().x,
-          ev.mouse().y,
-          std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - timepoint)
-            .count() });
-      } else if (ev == ftxui::Event::Escape) {
-        audio_player.stop();
+    auto view = ftxui::Renderer([&] {
+      TRACE_SCOPE("create_song render");
+      if (!start_song_when_ready()) { return loading_screen(); }
+      record_clicks();
+      return play_field.render();
+    });
+    return ftxui::CatchEvent(view, [&](ftxui::Event ev) {
+      if (!song_started && ev != ftxui::Event::Escape) { return false; }
+      if (audio_player().has_ended()) { game_iteration(GameState::SaveSongData); }
+      if (ev == ftxui::Event::Escape) {
+        audio_player().stop();
         game_iteration(GameState::SaveSongData);
       }
       return false;
     });
-
-    inputs->Add(event_handler);
-
-    return ftxui::Renderer([&] {
-      ftxui::Canvas c = ftxui::Canvas(CANVAS_CONSTANTS::SIZE, CANVAS_CONSTANTS::SIZE);
-      return ftxui::hbox({ ftxui::canvas(std::move(c)) | ftxui::border });
-    });
+  }
+  void enter_create_song()
+  {
+    initialize_song();
+    play_field.clear();
+    journal.start(song.name);
   }
   ftxui::Component save_song()
   {
-    save_song_to_disk(song);
-
-    inputs->Add(ftxui::Button(std::string("Back to menu"), [&] { game_iteration(GameState::MainMenu); }));
-
-    return ftxui::Renderer([&] {
-      return ftxui::vbox({ ftxui::hbox({ ftxui::filler(),
-                             ftxui::vbox({
-                               ftxui::text(R"(             _     _                                               )"),
-                               ftxui::text(R"(    /\      | |   | |                                              )"),
-                               ftxui::text(R"(   /  \   __| | __| |  _ __   _____      __  ___  ___  _ __   __ _ )"),
-                               ftxui::text(R"(  / /\ \ / _` |/ _` | | '_ \ / _ \ \ /\ / / / __|/ _ \| '_ \ / _` |)"),
-                               ftxui::text(R"( / ____ \ (_| | (_| | | | | |  __/\ V  V /  \__ \ (_) | | | | (_| |)"),
-                               ftxui::text(R"(/_/    \_\__,_|\__,_| |_| |_|\___| \_/\_/   |___/\___/|_| |_|\__, |)"),
-                               ftxui::text(R"(                                                              __/ |)"),
-                               ftxui::text(R"(                                                             |___/ )"),
-                             }),
-                             ftxui::filler() }),
+    auto inputs = ftxui::Container::Vertical({
+      ftxui::Button(std::string("Back to menu"), [&] { game_iteration(GameState::MainMenu); }),
+    });
+
+    return ftxui::Renderer(inputs, [&, inputs] {
+      return ftxui::vbox({ new_song_banner,
         ftxui::text(" "),
         ftxui::hbox({ ftxui::filler(),
-          ftxui::vbox({ ftxui::text("Music has been mapped and saved! You can go and play it now!"),
+          ftxui::vbox({ song_saved
+                          ? ftxui::text("Music has been mapped and saved! You can go and play it now!")
+                          : ftxui::text("The map could not be saved. Its notes are kept in the journal and will be "
+                                        "recovered on the next start."),
             ftxui::text(" "),
             inputs->Render() | ftxui::size(ftxui::WIDTH, ftxui::EQUAL, 60) }),
           ftxui::filler() }) });
     });
   }
+  void enter_save_song()
+  {
+    record_clicks();
+    journal.stop();
+    // on failure the journal stays behind, so the next start can still recover the notes
+    song_saved = save_song_to_disk(song);
+    if (!song_saved) { return; }
+    journal.discard();
+    library.update(song.name);
+  }
 
-  ftxui::Component renderer()
+  // Order of the prebuilt screens in `views`.
+  static constexpr std::array<GameState, 8> VIEW_ORDER{ GameState::MainMenu,
+    GameState::SongsMenu,
+    GameState::Play,
+    GameState::Scoreboard,
+    GameState::CreateSongMetadata,
+    GameState::CreateSongMetadata2,
+    GameState::CreateSongData,
+    GameState::SaveSongData };
+
+  static int view_index(const GameState game_state)
   {
-    switch (state) {
+    return static_cast<int>(std::find(VIEW_ORDER.begin(), VIEW_ORDER.end(), game_state) - VIEW_ORDER.begin());
+  }
+
+  ftxui::Component build_view(const GameState game_state)
+  {
+    switch (game_state) {
     case GameState::MainMenu:
       return main_menu();
     case GameState::SongsMenu:
@@ -352,30 +561,70 @@ private:
     return ftxui::Container::Vertical({});
   }
 
+  // Every screen is built once; a state change only runs the entry work of the new state and switches tabs.
   void game_iteration(GameState new_state)
   {
     if (state != new_state) {
+      TRACE_SCOPE("game_iteration");
+      if (state == GameState::Play) { simulation.reset(); }
       state = new_state;
-      inputs->DetachAllChildren();
-      std::this_thread::sleep_for(std::chrono::milliseconds(40));
-      render = renderer();
+      frames.set_animating(state == GameState::Play || state == GameState::CreateSongData);
+
+      switch (state) {
+      case GameState::SongsMenu:
+        enter_songs_menu();
+        break;
+      case GameState::Play:
+        enter_play();
+        break;
+      case GameState::CreateSongMetadata:
+        song = Song{};
+        break;
+      case GameState::CreateSongMetadata2:
+        std::filesystem::create_directories(generate_folder_path(song.name));
+        break;
+      case GameState::CreateSongData:
+        enter_create_song();
+        break;
+      case GameState::SaveSongData:
+        enter_save_song();
+        break;
+      case GameState::MainMenu:
+      case GameState::Scoreboard:
+        break;
+      }
+      active_view = view_index(state);
     }
   }
 
 public:
-  Game() : render{ renderer() }
+  // With a startup profile, the game quits as soon as the first frame has been built.
+  explicit Game(Settings game_settings, StartupProfile *profile = nullptr)
+    : settings{ std::move(game_settings) }, startup_profile{ profile }
   {
-    auto r = ftxui::Renderer(inputs, [&] { return render->Render(); });
-    std::atomic<bool> refresh_ui_continue = true;
+    if (startup_profile != nullptr) { startup_profile->mark("game state"); }
+    for (const auto view_state : VIEW_ORDER) { views->Add(build_view(view_state)); }
+    active_view = view_index(state);
+    if (startup_profile != nullptr) { startup_profile->mark("screens built"); }
+
+    auto r = ftxui::CatchEvent(ftxui::Renderer(views,
+                                 [&] {
+                                   TRACE_SCOPE("frame");
+                                   frames.frame_rendered();
+                                   auto frame = views->Render();
+                                   if (startup_profile != nullptr) {
+                                     startup_profile->mark("first frame");
+                                     startup_profile = nullptr;
+                                     screen.ExitLoopClosure()();
+                                   }
+                                   return frame;
+                                 }),
+      [&](ftxui::Event ev) {
+        capture_click(ev);
+        return false;
+      });
 
-    std::thread refresh_ui([&] {
-      while (refresh_ui_continue) {
-        std::this_thread::sleep_for(TIMING);
-        screen.PostEvent(ftxui::Event::Custom);
-      }
-    });
     screen.Loop(r);
-    refresh_ui_continue = false;
-    refresh_ui.join();
+    simulation.reset();
   }
 };
@@ -1,24 +1,121 @@
 #pragma once
 
+#include <AL/al.h>
 #include <smk/SoundBuffer.hpp>
-#include <smk/Sound.hpp>
 #include <smk/Audio.hpp>
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <system_error>
+
+#include "audio_cache.hpp"
+#include "audio_stream.hpp"
+#include "constants.hpp"
+#include "hitsounds.hpp"
+#include "trace.hpp"
+#include "types.hpp"
 
 class Audio
 {
-  // inout - initialized during "init_song"
-  smk::Sound sound;// NOLINT
-  smk::SoundBuffer buffer;
+  // the device has to outlive every buffer and sound
   smk::Audio audio;
+  HitsoundPool hitsounds;
+  SoundBufferCache cache;
+  PlaybackMode mode = PlaybackMode::Auto;
+  // inout - initialized during "init_song"
+  SoundBufferCache::Buffer buffer;
+  // played directly on an OpenAL source so the playback position can be queried
+  ALuint source = 0;
+  std::unique_ptr<AudioStream> stream;
+
+  void release_buffer()
+  {
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, 0);
+    buffer.reset();
+  }
+
+  // WAV, MP3, FLAC and Ogg Vorbis can be decoded incrementally; other formats are always decoded into memory.
+  // A compressed file is compared by its estimated decoded size.
+  [[nodiscard]] bool streams(const std::string &path) const
+  {
+    if (mode == PlaybackMode::Buffered || path.empty() || !StreamReader::supports(path)) { return false; }
+    if (mode == PlaybackMode::Streaming) { return true; }
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) { return false; }
+    if (StreamReader::extension_of(path) != ".wav") { size *= AUDIO_CONSTANTS::COMPRESSION_RATIO; }
+    return size >= AUDIO_CONSTANTS::STREAMING_MIN_BYTES;
+  }
 
 public:
+  explicit Audio(const std::size_t cache_bytes = AUDIO_CONSTANTS::CACHE_MB * AUDIO_CONSTANTS::BYTES_PER_MB)
+    : cache{ cache_bytes }
+  {
+    alGenSources(1, &source);
+  }
+  ~Audio()
+  {
+    stream.reset();
+    release_buffer();
+    alDeleteSources(1, &source);
+  }
+
+  Audio(const Audio &) = delete;
+  Audio &operator=(const Audio &) = delete;
+  Audio(Audio &&) = delete;
+  Audio &operator=(Audio &&) = delete;
+
+  void set_mode(const PlaybackMode new_mode) { mode = new_mode; }
+  void set_hitsound_volume(const int volume) { hitsounds.set_volume(volume); }
+  // Safe to call from the simulation thread while a song plays.
+  void play_hitsound(const HitSound sound) noexcept { hitsounds.trigger(sound); }
+  void prefetch(const std::string &path)
+  {
+    if (!path.empty() && !streams(path)) { cache.prefetch(path); }
+  }
+  // An empty path has nothing to decode and a streamed file needs no decode up front.
+  bool is_ready(const std::string &path) { return path.empty() || streams(path) || cache.get(path) != nullptr; }
   void init_song(const std::string& path)
   {
-    buffer = smk::SoundBuffer(path);
-    sound = smk::Sound(buffer);
-    sound.Play();
+    TRACE_SCOPE("Audio::init_song");
+    stream.reset();
+    release_buffer();
+    if (streams(path)) {
+      stream = std::make_unique<AudioStream>(path);
+      if (stream->is_open()) {
+        stream->play();
+        return;
+      }
+      stream.reset();
+    }
+
+    buffer = path.empty() ? nullptr : cache.get(path);
+    if (buffer == nullptr) { return; }
+    alSourcei(source, AL_BUFFER, static_cast<ALint>(buffer->buffer()));
+    alSourcePlay(source);
+  }
+  bool has_ended()
+  {
+    if (stream) { return !stream->is_playing(); }
+    ALint state = AL_STOPPED;
+    alGetSourcei(source, AL_SOURCE_STATE, &state);
+    return state != AL_PLAYING;
+  }
+  void stop()
+  {
+    if (stream) { stream->stop(); }
+    alSourceStop(source);
+  }
+  // Playback position as last reported by the device; it advances in steps of one mixing period.
+  long long position_ms()
+  {
+    if (stream) { return stream->position_ms(); }
+    if (buffer == nullptr) { return 0; }
+    ALint offset = 0;
+    ALint frequency = 0;
+    alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+    alGetBufferi(buffer->buffer(), AL_FREQUENCY, &frequency);
+    return frequency > 0 ? static_cast<long long>(offset) * 1000 / frequency : 0;
   }
-  bool has_ended() { return !sound.IsPlaying(); }
-  void stop() { sound.Stop(); }
 };
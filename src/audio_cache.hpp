@@ -0,0 +1,140 @@
+#pragma once
+
+#include <AL/al.h>
+#include <smk/SoundBuffer.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "constants.hpp"
+#include "trace.hpp"
+
+// Decodes sound files on a background thread and keeps the most recently used buffers, bounded by their
+// decoded size. A buffer that is evicted while still playing stays alive through its shared_ptr.
+class SoundBufferCache
+{
+public:
+  using Buffer = std::shared_ptr<const smk::SoundBuffer>;
+
+private:
+  struct Entry
+  {
+    std::string path;
+    Buffer buffer;
+    std::size_t bytes;
+  };
+
+  std::size_t capacity;
+  std::size_t used = 0;
+  std::list<Entry> lru;
+  std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+  std::deque<std::string> pending;
+  std::string decoding;
+  bool stopping = false;
+
+  std::mutex mutex;
+  std::condition_variable work_available;
+  std::thread worker;
+
+  static std::size_t decoded_size(const smk::SoundBuffer &buffer)
+  {
+    ALint bytes = 0;
+    alGetBufferi(buffer.buffer(), AL_SIZE, &bytes);
+    return static_cast<std::size_t>(std::max(bytes, 0));
+  }
+
+  void insert(const std::string &path, Buffer buffer, const std::size_t bytes)
+  {
+    lru.push_front({ path, std::move(buffer), bytes });
+    entries[path] = lru.begin();
+    used += bytes;
+    while (used > capacity && lru.size() > 1) {
+      used -= lru.back().bytes;
+      entries.erase(lru.back().path);
+      lru.pop_back();
+    }
+  }
+
+  void enqueue(const std::string &path)
+  {
+    if (entries.contains(path) || decoding == path) { return; }
+    std::erase(pending, path);
+    pending.push_front(path);
+    if (pending.size() > AUDIO_CONSTANTS::MAX_PENDING_DECODES) { pending.pop_back(); }
+    work_available.notify_one();
+  }
+
+  void run()
+  {
+    std::unique_lock lock{ mutex };
+    while (true) {
+      work_available.wait(lock, [&] { return stopping || !pending.empty(); });
+      if (stopping) { return; }
+      decoding = pending.front();
+      pending.pop_front();
+      const auto path = decoding;
+
+      lock.unlock();
+      Buffer buffer;
+      std::size_t bytes = 0;
+      try {
+        TRACE_SCOPE("decode");
+        auto decoded = std::make_shared<const smk::SoundBuffer>(path);
+        bytes = decoded_size(*decoded);
+        buffer = std::move(decoded);
+      } catch (const std::exception &) {
+        buffer = std::make_shared<const smk::SoundBuffer>();
+      }
+      lock.lock();
+
+      insert(path, std::move(buffer), bytes);
+      decoding.clear();
+    }
+  }
+
+public:
+  explicit SoundBufferCache(const std::size_t capacity_bytes = AUDIO_CONSTANTS::CACHE_MB * AUDIO_CONSTANTS::BYTES_PER_MB)
+    : capacity{ capacity_bytes }, worker{ [this] { run(); } }
+  {}
+  ~SoundBufferCache()
+  {
+    {
+      const std::lock_guard lock{ mutex };
+      stopping = true;
+    }
+    work_available.notify_one();
+    worker.join();
+  }
+
+  SoundBufferCache(const SoundBufferCache &) = delete;
+  SoundBufferCache &operator=(const SoundBufferCache &) = delete;
+  SoundBufferCache(SoundBufferCache &&) = delete;
+  SoundBufferCache &operator=(SoundBufferCache &&) = delete;
+
+  // Starts decoding in the background unless the file is already cached or being decoded.
+  void prefetch(const std::string &path)
+  {
+    const std::lock_guard lock{ mutex };
+    enqueue(path);
+  }
+
+  // Returns the decoded buffer, or nullptr while it is still being decoded.
+  Buffer get(const std::string &path)
+  {
+    const std::lock_guard lock{ mutex };
+    const auto it = entries.find(path);
+    if (it == entries.end()) {
+      enqueue(path);
+      return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->buffer;
+  }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <AL/al.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "constants.hpp"
+#include "stream_reader.hpp"
+
+// Plays a file through a small ring of OpenAL buffers which a background thread refills from disk,
+// so memory use does not grow with the length of the track. Compressed formats are decoded one chunk per refill.
+class AudioStream
+{
+  StreamReader reader;
+  std::array<ALuint, AUDIO_CONSTANTS::STREAM_BUFFERS> buffers{};
+  ALuint source = 0;
+  ALenum format = AL_FORMAT_STEREO16;
+  std::vector<std::int16_t> chunk;
+
+  std::atomic<std::uint64_t> played_frames = 0;
+  std::atomic<bool> playing = false;
+  std::atomic<bool> stopping = false;
+  std::thread refill;
+
+  bool fill(const ALuint buffer)
+  {
+    const auto frames = reader.read(chunk);
+    if (frames == 0) { return false; }
+    const auto bytes = frames * static_cast<std::size_t>(reader.channels()) * sizeof(std::int16_t);
+    alBufferData(buffer, format, chunk.data(), static_cast<ALsizei>(bytes), reader.sample_rate());
+    return true;
+  }
+
+  void run()
+  {
+    bool end_of_file = false;
+    while (!stopping) {
+      ALint processed = 0;
+      alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+      for (; processed > 0; --processed) {
+        ALuint buffer = 0;
+        alSourceUnqueueBuffers(source, 1, &buffer);
+        ALint bytes = 0;
+        alGetBufferi(buffer, AL_SIZE, &bytes);
+        played_frames += static_cast<std::uint64_t>(bytes) / (static_cast<std::uint64_t>(reader.channels()) * 2U);
+        end_of_file = end_of_file || !fill(buffer);
+        if (!end_of_file) { alSourceQueueBuffers(source, 1, &buffer); }
+      }
+
+      ALint state = AL_STOPPED;
+      alGetSourcei(source, AL_SOURCE_STATE, &state);
+      if (state != AL_PLAYING) {
+        ALint queued = 0;
+        alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+        if (queued == 0) { break; }
+        // the refill was late and the source ran dry - resume with what is queued
+        alSourcePlay(source);
+      }
+      std::this_thread::sleep_for(AUDIO_CONSTANTS::STREAM_REFILL_INTERVAL);
+    }
+    playing = false;
+  }
+
+public:
+  explicit AudioStream(const std::string &path)
+    : reader{ path }, chunk(AUDIO_CONSTANTS::STREAM_BUFFER_FRAMES * 2)
+  {
+    if (!reader.is_open() || reader.channels() > 2) { return; }
+    format = reader.channels() == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+    alGenSources(1, &source);
+    alGenBuffers(static_cast<ALsizei>(buffers.size()), buffers.data());
+  }
+  ~AudioStream()
+  {
+    stop();
+    if (source != 0) {
+      alDeleteSources(1, &source);
+      alDeleteBuffers(static_cast<ALsizei>(buffers.size()), buffers.data());
+    }
+  }
+
+  AudioStream(const AudioStream &) = delete;
+  AudioStream &operator=(const AudioStream &) = delete;
+  AudioStream(AudioStream &&) = delete;
+  AudioStream &operator=(AudioStream &&) = delete;
+
+  [[nodiscard]] bool is_open() const noexcept { return source != 0; }
+
+  void play()
+  {
+    if (!is_open() || playing) { return; }
+    ALsizei primed = 0;
+    while (static_cast<std::size_t>(primed) < buffers.size() && fill(buffers.at(static_cast<std::size_t>(primed)))) {
+      ++primed;
+    }
+    if (primed == 0) { return; }
+    alSourceQueueBuffers(source, primed, buffers.data());
+    alSourcePlay(source);
+    playing = true;
+    stopping = false;
+    refill = std::thread([this] { run(); });
+  }
+
+  void stop()
+  {
+    stopping = true;
+    if (refill.joinable()) { refill.join(); }
+    if (source != 0) {
+      alSourceStop(source);
+      alSourcei(source, AL_BUFFER, 0);
+    }
+    playing = false;
+  }
+
+  [[nodiscard]] bool is_playing() const noexcept { return playing; }
+
+  // Frames of already unqueued buffers plus the offset inside the buffer being played.
+  [[nodiscard]] long long position_ms() const
+  {
+    if (!is_open()) { return 0; }
+    ALint offset = 0;
+    alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+    const auto frames = played_frames + static_cast<std::uint64_t>(std::max(offset, 0));
+    return static_cast<long long>(frames * 1000U / static_cast<std::uint64_t>(reader.sample_rate()));
+  }
+};
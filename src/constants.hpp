@@ -1,5 +1,7 @@
 #pragma once
 #include <array>
+#include <chrono>
+#include <cstdint>
 
 #include "types.hpp"
 
@@ -11,6 +13,7 @@ struct TIME_CONSTANTS
   static constexpr long long NOTE_OK = 300;
   static constexpr long long NOTE_NICE = 200;
   static constexpr long long NOTE_GOOD = 100;
+  static constexpr auto SIMULATION_TICK = std::chrono::milliseconds(1);
 };
 
 struct POINT_CONSTANTS
@@ -32,12 +35,118 @@ struct CANVAS_CONSTANTS
 {
   static constexpr std::size_t SIZE = 150;
   static constexpr int CIRCLE_DIAMETER = 10;
-  static constexpr std::size_t NOTES_ON_SCREEN_LIMIT = 6;
   static constexpr std::array<int, 2> RATIO_FIX{ 2, 4 };
 };
 
+struct INPUT_CONSTANTS
+{
+  static constexpr std::size_t CLICK_QUEUE_SIZE = 256;
+};
+
 struct FILE_CONSTANTS
 {
   static constexpr char FOLDER_PATH[] = "songs";
   static constexpr char GAMEFILE_EXT[] = ".consu";
+  static constexpr char LIBRARY_INDEX[] = "songs.index";
+  static constexpr char LIBRARY_INDEX_HEADER[] = "consu-library 2";
+  static constexpr char SETTINGS_PATH[] = "settings.cfg";
+  static constexpr char REPLAY_FOLDER[] = "replays";
+  static constexpr char REPLAY_EXT[] = ".replay";
+  static constexpr char JOURNAL_EXT[] = ".journal";
+  static constexpr char TEMP_EXT[] = ".tmp";
+  static constexpr char SCORE_LOG[] = "scores.log";
+  static constexpr char SCORE_INDEX[] = "scores.index";
+  static constexpr char HITSOUND_FOLDER[] = "hitsounds";
+};
+
+struct AUDIO_CONSTANTS
+{
+  static constexpr std::size_t CACHE_MB = 64;
+  static constexpr std::size_t BYTES_PER_MB = 1024 * 1024;
+  static constexpr std::size_t MAX_PENDING_DECODES = 2;
+  static constexpr std::uintmax_t STREAMING_MIN_BYTES = 16 * 1024 * 1024;
+  // rough decoded-to-file size ratio of MP3, FLAC and Ogg Vorbis, used to pick streaming in auto mode
+  static constexpr std::uintmax_t COMPRESSION_RATIO = 8;
+  static constexpr std::size_t STREAM_BUFFERS = 4;
+  static constexpr std::size_t STREAM_BUFFER_FRAMES = 8192;
+  static constexpr auto STREAM_REFILL_INTERVAL = std::chrono::milliseconds(20);
+};
+
+struct HITSOUND_CONSTANTS
+{
+  static constexpr std::size_t VOICES = 16;
+  static constexpr std::size_t QUEUE_SIZE = 64;
+  // longer files are not hitsounds, the built-in tone is used instead
+  static constexpr std::uint64_t MAX_SAMPLE_FRAMES = 48000 * 2;
+  static constexpr int SYNTH_RATE = 44100;
+  static constexpr double SYNTH_SECONDS = 0.08;
+};
+
+struct BINARY_MAP_CONSTANTS
+{
+  static constexpr std::array<char, 4> MAGIC{ 'C', 'N', 'S', 'U' };
+  static constexpr std::uint32_t VERSION = 2;
+  // packed 16-byte notes, still readable
+  static constexpr std::uint32_t VERSION_PACKED_NOTES = 1;
+  static constexpr std::size_t ALIGNMENT = 8;
+};
+
+struct PACKED_MAP_CONSTANTS
+{
+  static constexpr std::array<char, 4> MAGIC{ 'C', 'N', 'S', 'P' };
+  static constexpr std::uint32_t VERSION = 1;
+  // notes per block; a multiple of 128 keeps every packed column a whole number of 128-bit words
+  static constexpr std::size_t BLOCK_NOTES = 128;
+};
+
+struct MENU_CONSTANTS
+{
+  static constexpr std::size_t SONG_LIST_ROWS = 20;
+};
+
+struct TRACE_CONSTANTS
+{
+  static constexpr std::size_t RING_EVENTS = 16384;
+  static constexpr auto OVERLAY_REFRESH = std::chrono::milliseconds(250);
+};
+
+struct REPLAY_CONSTANTS
+{
+  static constexpr std::array<char, 4> MAGIC{ 'C', 'N', 'S', 'R' };
+  static constexpr std::uint32_t VERSION = 1;
+};
+
+struct SCORE_CONSTANTS
+{
+  static constexpr std::array<char, 4> LOG_MAGIC{ 'C', 'N', 'S', 'L' };
+  static constexpr std::array<char, 4> INDEX_MAGIC{ 'C', 'N', 'S', 'I' };
+  static constexpr std::uint32_t VERSION = 1;
+  // log records not yet in the index that trigger a background compaction
+  static constexpr std::size_t COMPACT_AFTER = 1024;
+  static constexpr std::size_t TOP_SHOWN = 5;
+};
+
+struct JOURNAL_CONSTANTS
+{
+  static constexpr std::array<char, 4> MAGIC{ 'C', 'N', 'S', 'J' };
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr std::size_t QUEUE_SIZE = 4096;
+  static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(200);
+  static constexpr auto SYNC_INTERVAL = std::chrono::seconds(1);
+};
+
+struct ONSET_CONSTANTS
+{
+  // audio is averaged down to about this rate before analysis; onsets need no more bandwidth
+  static constexpr int ANALYSIS_RATE = 22050;
+  static constexpr std::size_t FFT_SIZE = 512;
+  static constexpr std::size_t HOP = 256;
+  static constexpr float LOG_COMPRESSION = 100.0F;
+  // frames on each side that a peak must dominate, and that make up its local mean
+  static constexpr std::size_t PEAK_RADIUS = 3;
+  static constexpr std::size_t MEAN_RADIUS = 16;
+  // on the flux normalized to the loudest onset of the track
+  static constexpr float THRESHOLD = 0.06F;
+  static constexpr long long MIN_GAP_MS = 120;
+  static constexpr std::size_t READ_FRAMES = 16384;
 };
@@ -0,0 +1,44 @@
+#include <fmt/format.h>
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "song.hpp"
+
+// One-shot converter of text and binary maps to the packed .consu format.
+// Usage: consu_convert [song...] - converts every folder in songs/ when no song is given.
+int main(int argc, char *argv[])
+{
+  try {
+    const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+    std::vector<std::string> stems(args.begin(), args.end());
+    if (stems.empty()) { stems = get_songs_list(); }
+
+    std::size_t converted = 0;
+    for (const auto &stem : stems) {
+      const auto path = generate_map_path(stem);
+      if (!std::filesystem::exists(path)) {
+        fmt::print("{}: no map found, skipped\n", stem);
+        continue;
+      }
+      if (detect_map_format(path) == MapFormat::Packed) {
+        fmt::print("{}: already packed, skipped\n", stem);
+        continue;
+      }
+
+      auto song = load_song_from_disk(stem);
+      song.name = stem;
+      save_song_to_disk(song, MapFormat::Packed);
+      fmt::print("{}: converted {} notes\n", stem, song.notes.size());
+      ++converted;
+    }
+    fmt::print("Converted {} of {} maps\n", converted, stems.size());
+  } catch (const std::exception &e) {
+    fmt::print("Unhandled exception in main: {}", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "constants.hpp"
+
+// Write-only file on a raw descriptor: every write() goes straight to the OS, and sync() waits until the data
+// is on disk, which buffered streams cannot promise.
+class DurableFile
+{
+#ifdef _WIN32
+  HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+  int fd = -1;
+#endif
+
+public:
+  enum class Mode { Truncate, Append };
+
+  DurableFile() = default;
+  DurableFile(const std::string &path, const Mode mode)
+  {
+#ifdef _WIN32
+    handle = CreateFileA(path.c_str(),
+      mode == Mode::Append ? FILE_APPEND_DATA : GENERIC_WRITE,
+      FILE_SHARE_READ,
+      nullptr,
+      mode == Mode::Append ? OPEN_ALWAYS : CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL,
+      nullptr);
+#else
+    const int flags = O_WRONLY | O_CREAT | (mode == Mode::Append ? O_APPEND : O_TRUNC);
+    fd = open(path.c_str(), flags, 0644);// NOLINT(cppcoreguidelines-pro-type-vararg)
+#endif
+  }
+  ~DurableFile() { close(); }
+
+  DurableFile(const DurableFile &) = delete;
+  DurableFile &operator=(const DurableFile &) = delete;
+#ifdef _WIN32
+  DurableFile(DurableFile &&other) noexcept : handle{ std::exchange(other.handle, INVALID_HANDLE_VALUE) } {}
+  DurableFile &operator=(DurableFile &&other) noexcept
+  {
+    if (this != &other) {
+      close();
+      handle = std::exchange(other.handle, INVALID_HANDLE_VALUE);
+    }
+    return *this;
+  }
+  [[nodiscard]] bool is_open() const noexcept { return handle != INVALID_HANDLE_VALUE; }
+#else
+  DurableFile(DurableFile &&other) noexcept : fd{ std::exchange(other.fd, -1) } {}
+  DurableFile &operator=(DurableFile &&other) noexcept
+  {
+    if (this != &other) {
+      close();
+      fd = std::exchange(other.fd, -1);
+    }
+    return *this;
+  }
+  [[nodiscard]] bool is_open() const noexcept { return fd >= 0; }
+#endif
+
+  // Writes all of `size` bytes, retrying short writes.
+  bool write(const char *data, std::size_t size) noexcept
+  {
+    if (!is_open()) { return false; }
+    while (size > 0) {
+#ifdef _WIN32
+      DWORD written = 0;
+      const auto chunk = static_cast<DWORD>(std::min<std::size_t>(size, 1U << 30U));
+      if (!WriteFile(handle, data, chunk, &written, nullptr) || written == 0) { return false; }
+#else
+      const auto written = ::write(fd, data, size);
+      if (written <= 0) { return false; }
+#endif
+      data += written;
+      size -= static_cast<std::size_t>(written);
+    }
+    return true;
+  }
+
+  bool sync() noexcept
+  {
+    if (!is_open()) { return false; }
+#ifdef _WIN32
+    return FlushFileBuffers(handle) != 0;
+#else
+    return fsync(fd) == 0;
+#endif
+  }
+
+  void close() noexcept
+  {
+#ifdef _WIN32
+    if (handle != INVALID_HANDLE_VALUE) { CloseHandle(std::exchange(handle, INVALID_HANDLE_VALUE)); }
+#else
+    if (fd >= 0) { ::close(std::exchange(fd, -1)); }
+#endif
+  }
+};
+
+// Replaces `path` with `size` bytes: they are written and synced to a temporary file next to it, which is then
+// renamed over it. A crash at any point leaves either the old or the new file, never a torn one.
+bool write_file_atomically(const std::string &path, const char *data, const std::size_t size)
+{
+  const auto tmp_path = path + FILE_CONSTANTS::TEMP_EXT;
+  {
+    DurableFile file{ tmp_path, DurableFile::Mode::Truncate };
+    if (!file.write(data, size) || !file.sync()) { return false; }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) { return false; }
+#ifndef _WIN32
+  // the rename itself is only durable once the directory entry is
+  const auto folder = std::filesystem::path{ path }.parent_path();
+  const int dir = open(folder.empty() ? "." : folder.c_str(), O_RDONLY);// NOLINT(cppcoreguidelines-pro-type-vararg)
+  if (dir >= 0) {
+    fsync(dir);
+    ::close(dir);
+  }
+#endif
+  return true;
+}
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+struct OutputStats
+{
+  std::size_t last_frame_bytes = 0;
+  std::size_t total_bytes = 0;
+  std::size_t frames = 0;
+  std::size_t full_frames = 0;
+};
+
+// Sits between FTXUI and the terminal as the streambuf of std::cout. Everything written up to a flush is one
+// frame. In damage mode the frame is parsed into a grid of cells and only the cells that differ from the
+// previously emitted frame are written, using relative cursor moves. Frames that cannot be diffed safely
+// (the first one, a resize, unknown escape sequences) are forwarded unchanged. Bytes are counted either way.
+class FrameOutput : public std::streambuf
+{
+  struct Style
+  {
+    bool bold = false;
+    bool dim = false;
+    bool italic = false;
+    bool underlined = false;
+    bool blink = false;
+    bool inverted = false;
+    // 0 is the default color, otherwise the SGR parameters packed as kind << 24 | value
+    std::uint32_t foreground = 0;
+    std::uint32_t background = 0;
+
+    bool operator==(const Style &) const = default;
+  };
+
+  struct Cell
+  {
+    std::array<char, 4> bytes{ ' ' };
+    std::uint8_t length = 1;
+    // 0 for the second column of a wide character
+    std::uint8_t width = 1;
+    Style style{};
+
+    bool operator==(const Cell &) const = default;
+  };
+
+  struct Write
+  {
+    int row;
+    int col;
+    Cell cell;
+  };
+
+  struct Frame
+  {
+    int rows = 0;
+    int cols = 0;
+    int end_row = 0;
+    int end_col = 0;
+    Style end_style{};
+    bool parsed = false;
+    std::string private_modes;
+    std::vector<Write> writes;
+    std::vector<Cell> cells;
+  };
+
+  static constexpr std::uint32_t COLOR_BASIC = 1;
+  static constexpr std::uint32_t COLOR_256 = 2;
+  static constexpr std::uint32_t COLOR_RGB = 3;
+
+  std::ostream *stream;
+  std::streambuf *terminal;
+  bool damage_tracking;
+  std::string pending;
+  std::string out;
+  Frame previous;
+  Frame current;
+  bool baseline = false;
+  int cursor_row = 0;
+  int cursor_col = 0;
+  OutputStats output_stats{};
+
+  static int codepoint_width(const char32_t c) noexcept
+  {
+    const bool wide = (c >= 0x1100 && c <= 0x115F) || (c >= 0x2E80 && c <= 0xA4CF) || (c >= 0xAC00 && c <= 0xD7A3)
+                      || (c >= 0xF900 && c <= 0xFAFF) || (c >= 0xFE30 && c <= 0xFE4F) || (c >= 0xFF00 && c <= 0xFF60)
+                      || (c >= 0xFFE0 && c <= 0xFFE6) || (c >= 0x1F300 && c <= 0x1F64F)
+                      || (c >= 0x1F900 && c <= 0x1F9FF) || (c >= 0x20000 && c <= 0x3FFFD);
+    return wide ? 2 : 1;
+  }
+
+  static void apply_sgr(Style &style, const std::vector<int> &params)
+  {
+    if (params.empty()) { style = {}; }
+    for (std::size_t i = 0; i < params.size(); ++i) {
+      const auto p = params[i];
+      const auto extended = [&](std::uint32_t &color) {
+        if (i + 2 < params.size() && params[i + 1] == 5) {
+          color = COLOR_256 << 24 | static_cast<std::uint32_t>(params[i + 2] & 0xFF);
+          i += 2;
+        } else if (i + 4 < params.size() && params[i + 1] == 2) {
+          color = COLOR_RGB << 24 | static_cast<std::uint32_t>((params[i + 2] & 0xFF) << 16)
+                  | static_cast<std::uint32_t>((params[i + 3] & 0xFF) << 8)
+                  | static_cast<std::uint32_t>(params[i + 4] & 0xFF);
+          i += 4;
+        }
+      };
+      if (p == 0) {
+        style = {};
+      } else if (p == 1) {
+        style.bold = true;
+      } else if (p == 2) {
+        style.dim = true;
+      } else if (p == 3) {
+        style.italic = true;
+      } else if (p == 4) {
+        style.underlined = true;
+      } else if (p == 5) {
+        style.blink = true;
+      } else if (p == 7) {
+        style.inverted = true;
+      } else if (p == 22) {
+        style.bold = style.dim = false;
+      } else if (p == 23) {
+        style.italic = false;
+      } else if (p == 24) {
+        style.underlined = false;
+      } else if (p == 25) {
+        style.blink = false;
+      } else if (p == 27) {
+        style.inverted = false;
+      } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+        style.foreground = COLOR_BASIC << 24 | static_cast<std::uint32_t>(p);
+      } else if (p == 38) {
+        extended(style.foreground);
+      } else if (p == 39) {
+        style.foreground = 0;
+      } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+        style.background = COLOR_BASIC << 24 | static_cast<std::uint32_t>(p);
+      } else if (p == 48) {
+        extended(style.background);
+      } else if (p == 49) {
+        style.background = 0;
+      }
+    }
+  }
+
+  static void append_color(std::string &sgr, const std::uint32_t color, const bool foreground)
+  {
+    const auto value = color & 0xFFFFFFU;
+    switch (color >> 24) {
+    case COLOR_BASIC:
+      fmt::format_to(std::back_inserter(sgr), ";{}", value);
+      break;
+    case COLOR_256:
+      fmt::format_to(std::back_inserter(sgr), ";{};5;{}", foreground ? 38 : 48, value);
+      break;
+    case COLOR_RGB:
+      fmt::format_to(std::back_inserter(sgr),
+        ";{};2;{};{};{}",
+        foreground ? 38 : 48,
+        value >> 16,
+        (value >> 8) & 0xFFU,
+        value & 0xFFU);
+      break;
+    default:
+      break;
+    }
+  }
+
+  static void append_style(std::string &sgr, const Style &style)
+  {
+    sgr += "\x1B[0";
+    if (style.bold) { sgr += ";1"; }
+    if (style.dim) { sgr += ";2"; }
+    if (style.italic) { sgr += ";3"; }
+    if (style.underlined) { sgr += ";4"; }
+    if (style.blink) { sgr += ";5"; }
+    if (style.inverted) { sgr += ";7"; }
+    append_color(sgr, style.foreground, true);
+    append_color(sgr, style.background, false);
+    sgr += 'm';
+  }
+
+  // Replays the cursor movement and printing of `data` into `frame`, relative to the first printed cell.
+  static void parse(const std::string &data, Frame &frame)
+  {
+    frame.writes.clear();
+    frame.private_modes.clear();
+    frame.parsed = false;
+
+    int row = 0;
+    int col = 0;
+    Style style{};
+    std::vector<int> params;
+    bool printed = false;
+    int first_row = 0;
+    int max_row = 0;
+    int max_col = 0;
+
+    for (std::size_t i = 0; i < data.size();) {
+      const auto c = static_cast<unsigned char>(data[i]);
+      if (c == 0x1B) {
+        if (i + 1 >= data.size() || data[i + 1] != '[') { return; }
+        auto j = i + 2;
+        const bool private_mode = j < data.size() && data[j] == '?';
+        if (private_mode) { ++j; }
+        params.clear();
+        int value = -1;
+        for (; j < data.size() && ((data[j] >= '0' && data[j] <= '9') || data[j] == ';'); ++j) {
+          if (data[j] == ';') {
+            params.push_back(std::max(value, 0));
+            value = -1;
+          } else {
+            value = std::max(value, 0) * 10 + (data[j] - '0');
+          }
+        }
+        if (j >= data.size()) { return; }
+        if (value >= 0) { params.push_back(value); }
+        const auto final_byte = data[j];
+        const auto count = params.empty() ? 1 : std::max(params.front(), 1);
+
+        if (private_mode && (final_byte == 'h' || final_byte == 'l')) {
+          frame.private_modes.append(data, i, j + 1 - i);
+        } else if (private_mode) {
+          return;
+        } else if (final_byte == 'm') {
+          apply_sgr(style, params);
+        } else if (final_byte == 'A') {
+          row -= count;
+        } else if (final_byte == 'B') {
+          row += count;
+        } else if (final_byte == 'C') {
+          col += count;
+        } else if (final_byte == 'D') {
+          col = std::max(col - count, 0);
+        } else if (final_byte == 'K' && !params.empty() && params.front() == 2) {
+          // only emitted together with a resize, which is never diffed
+        } else {
+          return;
+        }
+        i = j + 1;
+      } else if (c == '\r') {
+        col = 0;
+        ++i;
+      } else if (c == '\n') {
+        ++row;
+        ++i;
+      } else if (c == '\0') {
+        ++i;
+      } else if (c < 0x20) {
+        return;
+      } else {
+        const std::size_t length = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        if (i + length > data.size()) { return; }
+        char32_t codepoint = length == 1 ? c : c & (0xFFU >> (length + 1));
+        for (std::size_t k = 1; k < length; ++k) {
+          codepoint = codepoint << 6 | (static_cast<unsigned char>(data[i + k]) & 0x3FU);
+        }
+        Cell cell{};
+        std::copy_n(data.begin() + static_cast<std::ptrdiff_t>(i), length, cell.bytes.begin());
+        cell.length = static_cast<std::uint8_t>(length);
+        cell.width = static_cast<std::uint8_t>(codepoint_width(codepoint));
+        cell.style = style;
+        if (!printed) {
+          printed = true;
+          first_row = row;
+        }
+        frame.writes.push_back({ row, col, cell });
+        max_row = std::max(max_row, row);
+        col += cell.width;
+        max_col = std::max(max_col, col);
+        i += length;
+      }
+    }
+    if (!printed) { return; }
+
+    frame.rows = max_row - first_row + 1;
+    frame.cols = max_col;
+    frame.end_row = row - first_row;
+    frame.end_col = col;
+    frame.end_style = style;
+    frame.cells.assign(static_cast<std::size_t>(frame.rows * frame.cols), Cell{});
+    for (const auto &write : frame.writes) {
+      if (write.row < first_row) { return; }
+      const auto index = static_cast<std::size_t>((write.row - first_row) * frame.cols + write.col);
+      frame.cells[index] = write.cell;
+      if (write.cell.width == 2 && write.col + 1 < frame.cols) { frame.cells[index + 1].width = 0; }
+    }
+    frame.parsed = true;
+  }
+
+  void move_to(const int row, const int col)
+  {
+    if (row < cursor_row) { fmt::format_to(std::back_inserter(out), "\x1B[{}A", cursor_row - row); }
+    if (row > cursor_row) { fmt::format_to(std::back_inserter(out), "\x1B[{}B", row - cursor_row); }
+    if (col == 0 && cursor_col != 0) {
+      out += '\r';
+    } else if (col > cursor_col) {
+      fmt::format_to(std::back_inserter(out), "\x1B[{}C", col - cursor_col);
+    } else if (col < cursor_col) {
+      fmt::format_to(std::back_inserter(out), "\x1B[{}D", cursor_col - col);
+    }
+    cursor_row = row;
+    cursor_col = col;
+  }
+
+  void emit_damage()
+  {
+    out = current.private_modes;
+    // the cursor column is unknown after a write into the last column, a carriage return resets it
+    out += '\r';
+    cursor_col = 0;
+    Style style{};
+    for (int row = 0; row < current.rows; ++row) {
+      for (int col = 0; col < current.cols; ++col) {
+        const auto index = static_cast<std::size_t>(row * current.cols + col);
+        const auto &cell = current.cells[index];
+        if (cell.width == 0 || cell == previous.cells[index]) { continue; }
+        move_to(row, col);
+        if (cell.style != style) {
+          style = cell.style;
+          append_style(out, style);
+        }
+        out.append(cell.bytes.data(), cell.length);
+        cursor_col += cell.width;
+        if (cursor_col >= current.cols) {
+          out += '\r';
+          cursor_col = 0;
+        }
+      }
+    }
+    move_to(current.end_row, current.end_col);
+    if (style != current.end_style) { append_style(out, current.end_style); }
+  }
+
+  void emit_frame()
+  {
+    if (pending.empty()) { return; }
+    TRACE_SCOPE("frame output");
+    if (damage_tracking) {
+      parse(pending, current);
+      const bool same_size = current.parsed && current.rows == previous.rows && current.cols == previous.cols;
+      if (baseline && same_size) {
+        emit_damage();
+      } else {
+        out = pending;
+        cursor_row = current.end_row;
+        cursor_col = current.end_col;
+        ++output_stats.full_frames;
+      }
+      baseline = current.parsed;
+      std::swap(previous, current);
+    } else {
+      out = pending;
+    }
+    pending.clear();
+
+    terminal->sputn(out.data(), static_cast<std::streamsize>(out.size()));
+    output_stats.last_frame_bytes = out.size();
+    output_stats.total_bytes += out.size();
+    ++output_stats.frames;
+  }
+
+protected:
+  int_type overflow(const int_type c) override
+  {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) { pending += traits_type::to_char_type(c); }
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char *s, const std::streamsize count) override
+  {
+    pending.append(s, static_cast<std::size_t>(count));
+    return count;
+  }
+  int sync() override
+  {
+    emit_frame();
+    return terminal->pubsync();
+  }
+
+public:
+  FrameOutput(std::ostream &output, const bool track_damage)
+    : stream{ &output }, terminal{ output.rdbuf() }, damage_tracking{ track_damage }
+  {
+    stream->rdbuf(this);
+  }
+  ~FrameOutput() override
+  {
+    stream->rdbuf(terminal);
+    emit_frame();
+    terminal->pubsync();
+  }
+
+  FrameOutput(const FrameOutput &) = delete;
+  FrameOutput &operator=(const FrameOutput &) = delete;
+  FrameOutput(FrameOutput &&) = delete;
+  FrameOutput &operator=(FrameOutput &&) = delete;
+
+  [[nodiscard]] const OutputStats &stats() const noexcept { return output_stats; }
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+struct FrameStats
+{
+  std::size_t frames = 0;
+  double fps = 0;
+  double average_ms = 0;
+  double worst_ms = 0;
+  std::size_t late_frames = 0;
+};
+
+// Requests frames at the target rate only while the current screen animates and sleeps otherwise. A new
+// frame is only requested once the previous one was drawn, so a slow terminal is never flooded with events.
+class FrameScheduler
+{
+  using clock = std::chrono::steady_clock;
+  static constexpr std::size_t HISTORY = 128;
+
+  std::function<void()> request_frame;
+  clock::duration period;
+
+  bool animating = false;
+  bool stopping = false;
+  std::atomic<bool> frame_pending = false;
+  std::mutex mutex;
+  std::condition_variable wake;
+
+  // only touched from the UI thread
+  std::array<clock::duration, HISTORY> intervals{};
+  std::size_t frame_count = 0;
+  std::size_t recorded = 0;
+  bool measuring = false;
+  clock::time_point last_frame;
+
+  std::thread pacer;
+
+  void run()
+  {
+    std::unique_lock lock{ mutex };
+    while (!stopping) {
+      wake.wait(lock, [&] { return stopping || animating; });
+      auto next_frame = clock::now();
+      while (animating && !stopping) {
+        if (!frame_pending.exchange(true)) {
+          lock.unlock();
+          request_frame();
+          lock.lock();
+        }
+        next_frame = std::max(next_frame + period, clock::now() - period);
+        wake.wait_until(lock, next_frame, [&] { return stopping || !animating; });
+      }
+    }
+  }
+
+public:
+  FrameScheduler(std::function<void()> request, const int target_fps)
+    : request_frame{ std::move(request) },
+      period{ std::chrono::duration_cast<clock::duration>(std::chrono::seconds(1)) / std::max(target_fps, 1) },
+      pacer{ [this] { run(); } }
+  {}
+  ~FrameScheduler()
+  {
+    {
+      const std::lock_guard lock{ mutex };
+      stopping = true;
+    }
+    wake.notify_one();
+    pacer.join();
+  }
+
+  FrameScheduler(const FrameScheduler &) = delete;
+  FrameScheduler &operator=(const FrameScheduler &) = delete;
+  FrameScheduler(FrameScheduler &&) = delete;
+  FrameScheduler &operator=(FrameScheduler &&) = delete;
+
+  // Called from the UI thread; statistics restart whenever an animation starts.
+  void set_animating(const bool value)
+  {
+    if (value) {
+      recorded = 0;
+      measuring = false;
+    }
+    {
+      const std::lock_guard lock{ mutex };
+      animating = value;
+    }
+    wake.notify_one();
+  }
+
+  // Called by the root renderer for every drawn frame.
+  void frame_rendered()
+  {
+    const auto now = clock::now();
+    if (measuring) { intervals.at(recorded++ % HISTORY) = now - last_frame; }
+    measuring = true;
+    last_frame = now;
+    ++frame_count;
+    frame_pending = false;
+  }
+
+  // Statistics over the most recent frames of the current animation.
+  [[nodiscard]] FrameStats stats() const
+  {
+    FrameStats result{};
+    result.frames = frame_count;
+    const auto samples = std::min(recorded, HISTORY);
+    if (samples == 0) { return result; }
+
+    clock::duration total{};
+    clock::duration worst{};
+    for (std::size_t i = 0; i < samples; ++i) {
+      const auto interval = intervals.at(i);
+      total += interval;
+      worst = std::max(worst, interval);
+      if (interval > period + period / 2) { ++result.late_frames; }
+    }
+    const auto to_ms = [](const clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    result.average_ms = to_ms(total) / static_cast<double>(samples);
+    result.worst_ms = to_ms(worst);
+    result.fps = result.average_ms > 0 ? 1000.0 / result.average_ms : 0;
+    return result;
+  }
+};
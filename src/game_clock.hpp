@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+// Song timeline driven by the audio playback position. The device only advances its position once per
+// mixed period, so the clock interpolates with the steady clock between updates and never goes backwards.
+// Safe to read from the input and simulation threads at the same time.
+class GameClock
+{
+  using clock = std::chrono::steady_clock;
+
+  long long offset_ms = 0;
+  long long last_audio_ms = -1;
+  long long last_ms = 0;
+  clock::time_point last_update;
+  std::mutex mutex;
+
+public:
+  // A positive offset compensates for output latency: notes are judged that many milliseconds later.
+  void reset(const long long audio_offset_ms)
+  {
+    const std::lock_guard lock{ mutex };
+    offset_ms = audio_offset_ms;
+    last_audio_ms = -1;
+    last_ms = 0;
+  }
+
+  long long now(const long long audio_ms)
+  {
+    const std::lock_guard lock{ mutex };
+    const auto time = clock::now();
+    if (audio_ms != last_audio_ms) {
+      last_audio_ms = audio_ms;
+      last_update = time;
+    }
+    const auto interpolated =
+      last_audio_ms + std::chrono::duration_cast<std::chrono::milliseconds>(time - last_update).count();
+    last_ms = std::max(last_ms, interpolated);
+    return last_ms - offset_ms;
+  }
+};
@@ -0,0 +1,62 @@
+#include <fmt/format.h>
+
+#include <chrono>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "onset_detector.hpp"
+#include "song.hpp"
+#include "thread_pool.hpp"
+
+// Generates maps from the music of song folders by onset detection, one folder per worker thread.
+// Usage: consu_generate [song...] - without arguments, every folder in songs/ that has no map yet.
+int main(int argc, char *argv[])
+{
+  try {
+    const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+    std::vector<std::string> stems(args.begin(), args.end());
+    if (stems.empty()) {
+      for (const auto &stem : get_songs_list()) {
+        if (!std::filesystem::exists(generate_map_path(stem))) { stems.push_back(stem); }
+      }
+    }
+
+    ThreadPool pool;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> reports(stems.size());
+    std::vector<char> generated(stems.size(), 0);
+    pool.for_each_index(stems.size(), [&](std::size_t i) {
+      const auto &stem = stems[i];
+      if (!std::filesystem::is_directory(generate_folder_path(stem))) {
+        reports[i] = fmt::format("{}: no song folder, skipped", stem);
+        return;
+      }
+      const auto song = generate_song(stem);
+      if (song.notes.empty()) {
+        reports[i] = fmt::format("{}: no readable music file or no onsets found, skipped", stem);
+        return;
+      }
+      if (!save_song_to_disk(song)) {
+        reports[i] = fmt::format("{}: map could not be written", stem);
+        return;
+      }
+      reports[i] = fmt::format("{}: generated {} notes", stem, song.notes.size());
+      generated[i] = 1;
+    });
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < stems.size(); ++i) {
+      fmt::print("{}\n", reports[i]);
+      count += static_cast<std::size_t>(generated[i]);
+    }
+    fmt::print("Generated {} of {} maps in {:.2f} s on {} threads\n", count, stems.size(), seconds, pool.size());
+  } catch (const std::exception &e) {
+    fmt::print("Unhandled exception in main: {}", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "constants.hpp"
+#include "note_track.hpp"
+
+// Finds the notes under a click within a time window. Notes are bucketed into a grid of circle-sized cells over
+// the play field, so every note a click can touch lies in the 3x3 cells around it. Each cell lists its notes in
+// time order, so the window is a binary search per cell: O(log n + k) for k notes found.
+class HitIndex
+{
+  static constexpr int CELL = CANVAS_CONSTANTS::CIRCLE_DIAMETER;
+  static constexpr int CELLS_PER_SIDE = static_cast<int>(CANVAS_CONSTANTS::SIZE) / CELL;
+
+  const NoteTrack *notes;
+  // notes of cell c are cell_notes[cell_offsets[c]..cell_offsets[c + 1]), ascending
+  std::vector<std::uint32_t> cell_offsets;
+  std::vector<std::uint32_t> cell_notes;
+
+  // Positions outside the field fall into the border cells; clamping never moves two points further apart, so
+  // neighbours stay neighbours.
+  static int cell_coordinate(const int value) noexcept
+  {
+    return std::clamp(value, 0, CELLS_PER_SIDE * CELL - 1) / CELL;
+  }
+  static std::size_t cell_of(const int x, const int y) noexcept
+  {
+    return static_cast<std::size_t>(cell_coordinate(y) * CELLS_PER_SIDE + cell_coordinate(x));
+  }
+
+public:
+  explicit HitIndex(const NoteTrack &song_notes)
+    : notes{ &song_notes }, cell_offsets(static_cast<std::size_t>(CELLS_PER_SIDE * CELLS_PER_SIDE) + 1, 0),
+      cell_notes(song_notes.size())
+  {
+    // counting sort by cell keeps each cell in note order
+    for (std::size_t i = 0; i < notes->size(); ++i) { ++cell_offsets[cell_of(notes->x(i), notes->y(i)) + 1]; }
+    for (std::size_t c = 1; c < cell_offsets.size(); ++c) { cell_offsets[c] += cell_offsets[c - 1]; }
+    auto fill = cell_offsets;
+    for (std::size_t i = 0; i < notes->size(); ++i) {
+      cell_notes[fill[cell_of(notes->x(i), notes->y(i))]++] = static_cast<std::uint32_t>(i);
+    }
+  }
+
+  // Calls `found(index)` for every note with from_ms <= time <= to_ms whose circle contains (x, y), cell by cell.
+  template<typename Found> void query(const int x, const int y, const long long from_ms, const long long to_ms,
+    Found &&found) const
+  {
+    const auto column = cell_coordinate(x);
+    const auto row = cell_coordinate(y);
+    for (auto r = std::max(row - 1, 0); r <= std::min(row + 1, CELLS_PER_SIDE - 1); ++r) {
+      for (auto c = std::max(column - 1, 0); c <= std::min(column + 1, CELLS_PER_SIDE - 1); ++c) {
+        const auto cell = static_cast<std::size_t>(r * CELLS_PER_SIDE + c);
+        const auto begin = cell_notes.begin() + cell_offsets[cell];
+        const auto end = cell_notes.begin() + cell_offsets[cell + 1];
+        auto it = std::lower_bound(
+          begin, end, from_ms, [this](const std::uint32_t note, const long long ms) { return notes->time(note) < ms; });
+        for (; it != end && notes->time(*it) <= to_ms; ++it) {
+          if (std::hypot(notes->x(*it) - x, notes->y(*it) - y) <= CANVAS_CONSTANTS::CIRCLE_DIAMETER) { found(*it); }
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <AL/al.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "constants.hpp"
+#include "spsc_queue.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+#include "wav_reader.hpp"
+
+enum class HitSound : std::uint8_t { Miss = 0, Ok, Nice, Good, Perfect };
+
+constexpr std::array<const char *, 5> HIT_SOUND_NAMES{ "miss", "ok", "nice", "good", "perfect" };
+
+constexpr HitSound hit_sound_for(const Points &points) noexcept
+{
+  if (points.point >= POINT_CONSTANTS::PERFECT.point) { return HitSound::Perfect; }
+  if (points.point >= POINT_CONSTANTS::GOOD.point) { return HitSound::Good; }
+  if (points.point >= POINT_CONSTANTS::NICE.point) { return HitSound::Nice; }
+  if (points.point >= POINT_CONSTANTS::OK.point) { return HitSound::Ok; }
+  return HitSound::Miss;
+}
+
+// Interleaved 16-bit samples of a short sound.
+struct HitSample
+{
+  std::vector<std::int16_t> samples;
+  int channels = 1;
+  int rate = HITSOUND_CONSTANTS::SYNTH_RATE;
+};
+
+// A decaying tone, higher for better judgements; a miss is a low thud.
+HitSample synthesize_hit_sample(const HitSound sound)
+{
+  constexpr std::array<double, 5> pitches{ 110.0, 660.0, 880.0, 1175.0, 1760.0 };
+  const auto pitch = pitches[static_cast<std::size_t>(sound)];
+  const auto length = static_cast<std::size_t>(HITSOUND_CONSTANTS::SYNTH_RATE * HITSOUND_CONSTANTS::SYNTH_SECONDS);
+  HitSample sample;
+  sample.samples.resize(length);
+  for (std::size_t i = 0; i < length; ++i) {
+    const auto t = static_cast<double>(i) / HITSOUND_CONSTANTS::SYNTH_RATE;
+    const auto envelope = std::exp(-t * 60.0);
+    sample.samples[i] = static_cast<std::int16_t>(12000.0 * envelope * std::sin(2 * std::numbers::pi * pitch * t));
+  }
+  return sample;
+}
+
+// `hitsounds/<name>.wav` when there is one, otherwise the built-in tone.
+HitSample load_hit_sample(const HitSound sound)
+{
+  WavReader reader{ fmt::format(
+    "{}/{}.wav", FILE_CONSTANTS::HITSOUND_FOLDER, HIT_SOUND_NAMES[static_cast<std::size_t>(sound)]) };
+  if (!reader.is_open() || reader.frames() > HITSOUND_CONSTANTS::MAX_SAMPLE_FRAMES) {
+    return synthesize_hit_sample(sound);
+  }
+  HitSample sample;
+  sample.channels = reader.channels();
+  sample.rate = reader.sample_rate();
+  sample.samples.resize(reader.frames() * static_cast<std::size_t>(sample.channels));
+  std::size_t read = 0;
+  for (std::size_t frames = 1; frames > 0 && read < sample.samples.size();) {
+    frames = reader.read(std::span{ sample.samples }.subspan(read));
+    read += frames * static_cast<std::size_t>(sample.channels);
+  }
+  sample.samples.resize(read);
+  return sample;
+}
+
+// Judgement sounds played over the music. Every sample is decoded into an OpenAL buffer and a fixed set of
+// sources is created up front, so triggering a sound only pushes onto a lock-free queue. A mixer thread
+// wakes on the push, picks an idle voice - or steals the oldest one - and starts it; OpenAL mixes the voices
+// with the music source.
+class HitsoundPool
+{
+  std::array<ALuint, HIT_SOUND_NAMES.size()> buffers{};
+  std::array<ALuint, HITSOUND_CONSTANTS::VOICES> voices{};
+  std::size_t next_voice = 0;
+  NotifyingQueue<HitSound, HITSOUND_CONSTANTS::QUEUE_SIZE> queue;
+  std::thread mixer;
+
+  void play(const HitSound sound)
+  {
+    TRACE_SCOPE("hitsound");
+    auto voice = next_voice;
+    for (std::size_t i = 0; i < voices.size(); ++i) {
+      const auto candidate = (next_voice + i) % voices.size();
+      ALint state = AL_STOPPED;
+      alGetSourcei(voices[candidate], AL_SOURCE_STATE, &state);
+      if (state != AL_PLAYING) {
+        voice = candidate;
+        break;
+      }
+    }
+    next_voice = (voice + 1) % voices.size();
+    alSourceStop(voices[voice]);
+    alSourcei(voices[voice], AL_BUFFER, static_cast<ALint>(buffers[static_cast<std::size_t>(sound)]));
+    alSourcePlay(voices[voice]);
+  }
+
+  void run()
+  {
+    while (queue.wait_and_drain([this](const HitSound sound) { play(sound); })) {}
+  }
+
+public:
+  HitsoundPool()
+  {
+    TRACE_SCOPE("hitsound decode");
+    alGenBuffers(static_cast<ALsizei>(buffers.size()), buffers.data());
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      const auto sample = load_hit_sample(static_cast<HitSound>(i));
+      alBufferData(buffers[i],
+        sample.channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16,
+        sample.samples.data(),
+        static_cast<ALsizei>(sample.samples.size() * sizeof(std::int16_t)),
+        sample.rate);
+    }
+    alGenSources(static_cast<ALsizei>(voices.size()), voices.data());
+    for (const auto voice : voices) { alSourcei(voice, AL_SOURCE_RELATIVE, AL_TRUE); }
+    mixer = std::thread{ [this] { run(); } };
+  }
+  ~HitsoundPool()
+  {
+    queue.close();
+    mixer.join();
+    for (const auto voice : voices) { alSourceStop(voice); }
+    alDeleteSources(static_cast<ALsizei>(voices.size()), voices.data());
+    alDeleteBuffers(static_cast<ALsizei>(buffers.size()), buffers.data());
+  }
+
+  HitsoundPool(const HitsoundPool &) = delete;
+  HitsoundPool &operator=(const HitsoundPool &) = delete;
+  HitsoundPool(HitsoundPool &&) = delete;
+  HitsoundPool &operator=(HitsoundPool &&) = delete;
+
+  // Volume from 0 to 100, relative to the music.
+  void set_volume(const int volume)
+  {
+    const auto gain = static_cast<float>(std::clamp(volume, 0, 100)) / 100.0F;
+    for (const auto voice : voices) { alSourcef(voice, AL_GAIN, gain); }
+  }
+
+  // Single producer; never blocks or allocates. Returns false when the sound was dropped because the mixer
+  // is a whole queue behind.
+  bool trigger(const HitSound sound) noexcept
+  {
+    return queue.push(sound);
+  }
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "constants.hpp"
+#include "hit_index.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+
+// Which notes have been judged: everything before `first_unjudged`, plus the few notes after it that were
+// clicked ahead of earlier ones.
+struct JudgedNotes
+{
+  std::size_t first_unjudged = 0;
+  // ascending, all greater than first_unjudged
+  std::vector<std::size_t> ahead;
+
+  [[nodiscard]] bool contains(const std::size_t note) const noexcept
+  {
+    return note < first_unjudged || std::binary_search(ahead.begin(), ahead.end(), note);
+  }
+};
+
+// Judgement rules of a play, independent of rendering and of when they are evaluated: the outcome only
+// depends on the notes and on the capture times of the clicks.
+//
+// A click judges the earliest unjudged note on screen whose circle contains it, so stacked and simultaneous
+// notes can be played in any order; a note clicked too early is a miss. score.note_no counts judged notes.
+class Judge
+{
+  const NoteTrack *notes;
+  HitIndex hits;
+  JudgedNotes judged;
+  Score score{};
+  const char *last_hit = "";
+
+  void mark_judged(const std::size_t note)
+  {
+    ++score.note_no;
+    if (note != judged.first_unjudged) {
+      judged.ahead.insert(std::lower_bound(judged.ahead.begin(), judged.ahead.end(), note), note);
+      return;
+    }
+    ++judged.first_unjudged;
+    skip_judged();
+  }
+
+  void skip_judged()
+  {
+    auto skipped = judged.ahead.begin();
+    while (skipped != judged.ahead.end() && *skipped == judged.first_unjudged) {
+      ++skipped;
+      ++judged.first_unjudged;
+    }
+    judged.ahead.erase(judged.ahead.begin(), skipped);
+  }
+
+public:
+  explicit Judge(const NoteTrack &song_notes) : notes{ &song_notes }, hits{ song_notes } {}
+
+  // Every unjudged note whose time has passed is a miss. Returns how many notes that missed.
+  std::size_t expire(const long long time_ms)
+  {
+    std::size_t missed = 0;
+    while (judged.first_unjudged < notes->size() && notes->time(judged.first_unjudged) < time_ms) {
+      last_hit = POINT_CONSTANTS::MISS_TXT;
+      score.combo = 0;
+      mark_judged(judged.first_unjudged);
+      ++missed;
+    }
+    return missed;
+  }
+
+  // The judgement of the note the click hit, if it hit one.
+  std::optional<Points> click(const TimedClick &click)
+  {
+    expire(click.time_ms);
+
+    auto target = notes->size();
+    hits.query(click.x,
+      click.y,
+      click.time_ms,
+      click.time_ms + TIME_CONSTANTS::MAX_TIME_DISPLAY_NOTE,
+      [&](const std::size_t note) {
+        if (note < target && !judged.contains(note)) { target = note; }
+      });
+    if (target == notes->size()) { return std::nullopt; }
+
+    const auto points = time_to_points(notes->time(target) - click.time_ms);
+    const auto [point, msg] = points;
+    if (point == POINT_CONSTANTS::MISS.point) {
+      score.combo = 0;
+    } else {
+      ++score.combo;
+      score.max_combo = std::max(score.combo, score.max_combo);
+      score.points += point;
+    }
+    last_hit = msg;
+    mark_judged(target);
+    return points;
+  }
+
+  [[nodiscard]] const Score &current_score() const noexcept { return score; }
+  [[nodiscard]] const char *last_hit_msg() const noexcept { return last_hit; }
+  [[nodiscard]] const JudgedNotes &judged_notes() const noexcept { return judged; }
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "constants.hpp"
+#include "durable_file.hpp"
+#include "mapped_file.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+
+// One finished play on the leaderboard.
+struct ScoreEntry
+{
+  std::uint64_t points;
+  std::int64_t recorded_at_ms;
+  std::uint32_t max_combo;
+  std::uint32_t reserved;
+};
+
+// Score log layout (little-endian): ScoreLogHeader, then one ScoreRecord per play in the order they finished.
+// Songs are identified by the 64-bit FNV-1a hash of their stem, so every record has the same size and a torn
+// last record is easy to spot.
+struct ScoreLogHeader
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint64_t reserved;
+};
+
+struct ScoreRecord
+{
+  std::uint64_t song_key;
+  ScoreEntry entry;
+};
+
+// Score index layout: ScoreIndexHeader, song_count ScoreIndexSongs sorted by key, then entry_count ScoreEntries.
+// The entries of a song are a contiguous run, best first. The index holds the first `log_records` records of the
+// log; the rest are read into memory at load.
+struct ScoreIndexHeader
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint64_t log_records;
+  std::uint64_t song_count;
+  std::uint64_t entry_count;
+};
+
+struct ScoreIndexSong
+{
+  std::uint64_t song_key;
+  std::uint64_t first;
+  std::uint64_t count;
+};
+
+static_assert(sizeof(ScoreEntry) == 24 && std::is_trivially_copyable_v<ScoreEntry>);
+static_assert(sizeof(ScoreLogHeader) == 16 && std::is_trivially_copyable_v<ScoreLogHeader>);
+static_assert(sizeof(ScoreRecord) == 32 && std::is_trivially_copyable_v<ScoreRecord>);
+static_assert(sizeof(ScoreIndexHeader) == 32 && std::is_trivially_copyable_v<ScoreIndexHeader>);
+static_assert(sizeof(ScoreIndexSong) == 24 && std::is_trivially_copyable_v<ScoreIndexSong>);
+
+constexpr std::uint64_t score_song_key(const std::string_view stem) noexcept
+{
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (const auto c : stem) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// More points first; on a tie the earlier play keeps the higher place.
+constexpr bool ranks_before(const ScoreEntry &lhs, const ScoreEntry &rhs) noexcept
+{
+  return lhs.points != rhs.points ? lhs.points > rhs.points : lhs.recorded_at_ms < rhs.recorded_at_ms;
+}
+
+// Complete records of the log from record `from` on.
+std::vector<ScoreRecord> read_score_log(const std::string &path, const std::size_t from)
+{
+  std::vector<ScoreRecord> records;
+  std::ifstream file{ path, std::ios::binary };
+  ScoreLogHeader header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))// NOLINT
+      || header.magic != SCORE_CONSTANTS::LOG_MAGIC || header.version != SCORE_CONSTANTS::VERSION) {
+    return records;
+  }
+  file.seekg(static_cast<std::streamoff>(sizeof(header) + from * sizeof(ScoreRecord)));
+  for (ScoreRecord record{}; file.read(reinterpret_cast<char *>(&record), sizeof(record));) {// NOLINT
+    records.push_back(record);
+  }
+  return records;
+}
+
+// Read-only view of a score index file; empty when the file is missing or malformed.
+class ScoreIndexView
+{
+  MappedFile map;
+  ScoreIndexHeader header{};
+
+  [[nodiscard]] std::size_t entries_offset() const noexcept
+  {
+    return sizeof(ScoreIndexHeader) + header.song_count * sizeof(ScoreIndexSong);
+  }
+
+public:
+  ScoreIndexView() = default;
+  explicit ScoreIndexView(const std::string &path) : map{ path }
+  {
+    if (map.size() < sizeof(header)) { return; }
+    std::memcpy(&header, map.data(), sizeof(header));
+    const auto songs_fit = header.song_count <= (map.size() - sizeof(header)) / sizeof(ScoreIndexSong);
+    if (header.magic != SCORE_CONSTANTS::INDEX_MAGIC || header.version != SCORE_CONSTANTS::VERSION || !songs_fit
+        || header.entry_count > (map.size() - entries_offset()) / sizeof(ScoreEntry)) {
+      header = {};
+    }
+  }
+
+  [[nodiscard]] std::size_t log_records() const noexcept { return header.log_records; }
+  [[nodiscard]] std::size_t song_count() const noexcept { return header.song_count; }
+
+  [[nodiscard]] ScoreIndexSong song(const std::size_t i) const noexcept
+  {
+    ScoreIndexSong value{};
+    std::memcpy(&value, map.data() + sizeof(ScoreIndexHeader) + i * sizeof(ScoreIndexSong), sizeof(value));
+    return value;
+  }
+
+  [[nodiscard]] ScoreEntry entry(const std::size_t i) const noexcept
+  {
+    ScoreEntry value{};
+    std::memcpy(&value, map.data() + entries_offset() + i * sizeof(ScoreEntry), sizeof(value));
+    return value;
+  }
+
+  // The run of the song's entries, as [first, first + count); empty when the song has none.
+  [[nodiscard]] ScoreIndexSong find(const std::uint64_t song_key) const noexcept
+  {
+    std::size_t low = 0;
+    std::size_t high = song_count();
+    while (low < high) {
+      const auto middle = low + (high - low) / 2;
+      if (song(middle).song_key < song_key) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if (low < song_count() && song(low).song_key == song_key) {
+      const auto found = song(low);
+      if (found.first + found.count <= header.entry_count) { return found; }
+    }
+    return { song_key, 0, 0 };
+  }
+};
+
+// Merges the records of the log that the index at `index_path` does not hold yet into a new index, replacing it
+// atomically. Runs on its own; other processes may keep appending to the log meanwhile.
+bool compact_scores(const std::string &log_path, const std::string &index_path)
+{
+  TRACE_SCOPE("score compaction");
+  const ScoreIndexView old{ index_path };
+  auto tail = read_score_log(log_path, old.log_records());
+  std::sort(tail.begin(), tail.end(), [](const ScoreRecord &lhs, const ScoreRecord &rhs) {
+    return lhs.song_key != rhs.song_key ? lhs.song_key < rhs.song_key : ranks_before(lhs.entry, rhs.entry);
+  });
+
+  std::vector<ScoreIndexSong> songs;
+  std::vector<ScoreEntry> entries;
+  std::size_t next_song = 0;
+  std::size_t next_record = 0;
+  while (next_song < old.song_count() || next_record < tail.size()) {
+    const auto old_key = next_song < old.song_count() ? old.song(next_song).song_key : ~std::uint64_t{ 0 };
+    const auto new_key = next_record < tail.size() ? tail[next_record].song_key : ~std::uint64_t{ 0 };
+    const auto key = std::min(old_key, new_key);
+    const auto run = key == old_key && next_song < old.song_count() ? old.song(next_song++) : ScoreIndexSong{};
+    auto from_old = run.first;
+    const auto old_end = run.first + run.count;
+
+    songs.push_back({ key, entries.size(), 0 });
+    while (from_old < old_end || (next_record < tail.size() && tail[next_record].song_key == key)) {
+      const bool take_old = next_record >= tail.size() || tail[next_record].song_key != key
+                            || (from_old < old_end && !ranks_before(tail[next_record].entry, old.entry(from_old)));
+      entries.push_back(take_old ? old.entry(from_old++) : tail[next_record++].entry);
+    }
+    songs.back().count = entries.size() - songs.back().first;
+  }
+
+  const ScoreIndexHeader header{ SCORE_CONSTANTS::INDEX_MAGIC,
+    SCORE_CONSTANTS::VERSION,
+    old.log_records() + tail.size(),
+    songs.size(),
+    entries.size() };
+  std::vector<char> buffer(
+    sizeof(header) + songs.size() * sizeof(ScoreIndexSong) + entries.size() * sizeof(ScoreEntry));
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  auto *at = buffer.data() + sizeof(header);
+  if (!songs.empty()) { std::memcpy(at, songs.data(), songs.size() * sizeof(ScoreIndexSong)); }
+  at += songs.size() * sizeof(ScoreIndexSong);
+  if (!entries.empty()) { std::memcpy(at, entries.data(), entries.size() * sizeof(ScoreEntry)); }
+  return write_file_atomically(index_path, buffer.data(), buffer.size());
+}
+
+// Personal bests and rankings of every song. Plays are appended to a log; a background thread folds the log
+// into a sorted index once enough records pile up. Queries binary-search the mapped index and the sorted
+// in-memory runs of the records it does not hold yet, so they cost O(log n) however long the log grows.
+class Leaderboard
+{
+  std::string log_path;
+  std::string index_path;
+  ScoreIndexView index;
+  // records past the index, per song, best first
+  std::unordered_map<std::uint64_t, std::vector<ScoreEntry>> pending;
+  std::size_t pending_count = 0;
+  std::thread compactor;
+  std::atomic<bool> compacted = false;
+
+  void insert_pending(const ScoreRecord &record)
+  {
+    auto &run = pending[record.song_key];
+    run.insert(std::upper_bound(run.begin(), run.end(), record.entry, ranks_before), record.entry);
+    ++pending_count;
+  }
+
+  void reload()
+  {
+    index = ScoreIndexView{ index_path };
+    pending.clear();
+    pending_count = 0;
+    for (const auto &record : read_score_log(log_path, index.log_records())) { insert_pending(record); }
+  }
+
+  // Swaps in the index of a finished compaction and starts a new one when enough records are pending.
+  void maintain()
+  {
+    if (compactor.joinable() && compacted) {
+      compactor.join();
+      reload();
+    }
+    if (!compactor.joinable() && pending_count >= SCORE_CONSTANTS::COMPACT_AFTER) {
+      compacted = false;
+      compactor = std::thread{ [this, log = log_path, target = index_path] {
+        compact_scores(log, target);
+        compacted = true;
+      } };
+    }
+  }
+
+public:
+  explicit Leaderboard(std::string log = FILE_CONSTANTS::SCORE_LOG,
+    std::string index_file = FILE_CONSTANTS::SCORE_INDEX)
+    : log_path{ std::move(log) }, index_path{ std::move(index_file) }
+  {}
+  Leaderboard(const Leaderboard &) = delete;
+  Leaderboard &operator=(const Leaderboard &) = delete;
+  ~Leaderboard()
+  {
+    if (compactor.joinable()) { compactor.join(); }
+  }
+
+  // Reads the index and the records past it. A torn last record, left by a crash mid-write, is cut off so that
+  // later appends stay aligned.
+  void load()
+  {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(log_path, ec);
+    if (!ec && size > sizeof(ScoreLogHeader) && (size - sizeof(ScoreLogHeader)) % sizeof(ScoreRecord) != 0) {
+      std::filesystem::resize_file(log_path, size - (size - sizeof(ScoreLogHeader)) % sizeof(ScoreRecord), ec);
+    }
+    reload();
+    maintain();
+  }
+
+  // Appends the play to the log and syncs it. Returns false when the log could not be written.
+  bool add(const std::string &stem, const Score &score, const std::int64_t recorded_at_ms)
+  {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(log_path, ec);
+    DurableFile file{ log_path, DurableFile::Mode::Append };
+    if (!file.is_open()) { return false; }
+    if (ec || size == 0) {
+      const ScoreLogHeader header{ SCORE_CONSTANTS::LOG_MAGIC, SCORE_CONSTANTS::VERSION, 0 };
+      if (!file.write(reinterpret_cast<const char *>(&header), sizeof(header))) { return false; }// NOLINT
+    }
+    const auto max_combo = std::min<std::size_t>(score.max_combo, std::numeric_limits<std::uint32_t>::max());
+    const ScoreRecord record{ score_song_key(stem),
+      { score.points, recorded_at_ms, static_cast<std::uint32_t>(max_combo), 0 } };
+    if (!file.write(reinterpret_cast<const char *>(&record), sizeof(record)) || !file.sync()) { return false; }// NOLINT
+    insert_pending(record);
+    maintain();
+    return true;
+  }
+
+  // Plays of the song.
+  [[nodiscard]] std::size_t count(const std::string &stem) const
+  {
+    const auto key = score_song_key(stem);
+    const auto it = pending.find(key);
+    return index.find(key).count + (it == pending.end() ? 0 : it->second.size());
+  }
+
+  // 1-based place a play with `points` takes among the plays of the song: one more than the plays that scored
+  // strictly more.
+  [[nodiscard]] std::size_t rank(const std::string &stem, const std::uint64_t points) const
+  {
+    const auto key = score_song_key(stem);
+    const auto run = index.find(key);
+    std::size_t low = run.first;
+    std::size_t high = run.first + run.count;
+    while (low < high) {
+      const auto middle = low + (high - low) / 2;
+      if (index.entry(middle).points > points) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    std::size_t better = low - run.first;
+    if (const auto it = pending.find(key); it != pending.end()) {
+      const auto &entries = it->second;
+      const auto worse = std::partition_point(
+        entries.begin(), entries.end(), [&](const ScoreEntry &entry) { return entry.points > points; });
+      better += static_cast<std::size_t>(worse - entries.begin());
+    }
+    return better + 1;
+  }
+
+  // The best `k` plays of the song, best first.
+  [[nodiscard]] std::vector<ScoreEntry> top(const std::string &stem, const std::size_t k) const
+  {
+    const auto key = score_song_key(stem);
+    const auto run = index.find(key);
+    const auto it = pending.find(key);
+    const auto *const tail = it == pending.end() ? nullptr : &it->second;
+
+    std::vector<ScoreEntry> best;
+    std::size_t from_index = run.first;
+    std::size_t from_tail = 0;
+    while (best.size() < k) {
+      const bool has_index = from_index < run.first + run.count;
+      const bool has_tail = tail != nullptr && from_tail < tail->size();
+      if (!has_index && !has_tail) { break; }
+      if (has_tail && (!has_index || ranks_before((*tail)[from_tail], index.entry(from_index)))) {
+        best.push_back((*tail)[from_tail++]);
+      } else {
+        best.push_back(index.entry(from_index++));
+      }
+    }
+    return best;
+  }
+
+  // Blocks until a running compaction is done and folds every pending record into the index.
+  void compact()
+  {
+    if (compactor.joinable()) { compactor.join(); }
+    compact_scores(log_path, index_path);
+    reload();
+  }
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "constants.hpp"
+#include "map_stats.hpp"
+#include "song.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+struct LibraryEntry
+{
+  std::string stem;
+  std::string audio_file;
+  std::string map_path;
+  std::size_t note_count = 0;
+  std::int64_t mtime = 0;
+  MapStats stats;
+};
+
+// On-disk index of the songs folder, kept next to it so that writing the index does not bump the folder's
+// mtime. The folder is only walked again when its mtime changes; a song is only re-read when its folder, map or
+// music file changed.
+class SongLibrary
+{
+  std::vector<LibraryEntry> entries;
+  std::unordered_map<std::string, std::size_t> by_stem;
+  std::int64_t root_mtime = 0;
+  bool dirty = false;
+  std::size_t change_count = 0;
+  std::size_t stats_change_count = 0;
+
+  // Newest change to what the entry was read from. Rewriting a file in place leaves the folder's mtime alone,
+  // so the map and the music file are checked too.
+  static std::int64_t content_mtime(const LibraryEntry &entry)
+  {
+    auto mtime = std::max(mtime_of(generate_folder_path(entry.stem)), mtime_of(entry.map_path));
+    if (!entry.audio_file.empty()) {
+      mtime = std::max(mtime, mtime_of(fmt::format("{}/{}", generate_folder_path(entry.stem), entry.audio_file)));
+    }
+    return mtime;
+  }
+
+  static LibraryEntry scan_folder(const std::string &stem)
+  {
+    LibraryEntry entry{ stem, {}, generate_map_path(stem), 0, 0, {} };
+    std::error_code ec;
+    if (std::filesystem::is_directory(generate_folder_path(stem), ec)) { entry.audio_file = find_song(stem); }
+    entry.note_count = read_note_count(entry.map_path);
+    entry.mtime = content_mtime(entry);
+    return entry;
+  }
+
+  // stats carry the key of the map they came from, the analysis pass decides whether they are stale
+  static LibraryEntry rescan(const LibraryEntry &known)
+  {
+    auto entry = scan_folder(known.stem);
+    entry.stats = known.stats;
+    return entry;
+  }
+
+  void reindex()
+  {
+    std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) { return lhs.stem < rhs.stem; });
+    by_stem.clear();
+    for (std::size_t i = 0; i < entries.size(); ++i) { by_stem.emplace(entries[i].stem, i); }
+    ++change_count;
+  }
+
+public:
+  static std::int64_t mtime_of(const std::filesystem::path &path)
+  {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::numeric_limits<std::int64_t>::min() : std::int64_t{ time.time_since_epoch().count() };
+  }
+
+  void load()
+  {
+    entries.clear();
+    std::ifstream file{ FILE_CONSTANTS::LIBRARY_INDEX };
+    std::string line;
+    if (!std::getline(file, line) || line != FILE_CONSTANTS::LIBRARY_INDEX_HEADER) {
+      root_mtime = 0;
+      reindex();
+      return;
+    }
+    if (std::getline(file, line)) { std::istringstream{ line } >> root_mtime; }
+
+    while (std::getline(file, line)) {
+      std::istringstream iss(line);
+      LibraryEntry entry;
+      if (std::getline(iss, entry.stem, '\t') && std::getline(iss, entry.audio_file, '\t')
+          && std::getline(iss, entry.map_path, '\t') && iss >> entry.note_count >> entry.mtime) {
+        auto &stats = entry.stats;
+        if (!(iss >> stats.analyzed >> stats.map_mtime >> stats.map_size >> stats.duration_ms >> stats.note_count
+                >> stats.peak_notes_per_second >> stats.average_jump)) {
+          stats = {};
+        }
+        entries.push_back(std::move(entry));
+      }
+    }
+    reindex();
+  }
+
+  void save()
+  {
+    const std::string tmp_path = fmt::format("{}.tmp", FILE_CONSTANTS::LIBRARY_INDEX);
+    {
+      std::ofstream file{ tmp_path };
+      file << FILE_CONSTANTS::LIBRARY_INDEX_HEADER << '\n' << root_mtime << '\n';
+      for (const auto &entry : entries) {
+        file << entry.stem << '\t' << entry.audio_file << '\t' << entry.map_path << '\t' << entry.note_count << ' '
+             << entry.mtime;
+        const auto &stats = entry.stats;
+        file << '\t' << stats.analyzed << ' ' << stats.map_mtime << ' ' << stats.map_size << ' ' << stats.duration_ms
+             << ' ' << stats.note_count << ' ' << stats.peak_notes_per_second << ' ' << stats.average_jump << '\n';
+      }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, FILE_CONSTANTS::LIBRARY_INDEX, ec);
+    dirty = false;
+  }
+
+  // Cheap when nothing changed: a few stats per song and no directory walk.
+  void refresh()
+  {
+    TRACE_SCOPE("library refresh");
+    const std::filesystem::path root{ FILE_CONSTANTS::FOLDER_PATH };
+    if (!std::filesystem::exists(root)) { std::filesystem::create_directories(root); }
+
+    const auto current_mtime = mtime_of(root);
+    if (current_mtime != root_mtime) {
+      std::vector<LibraryEntry> updated;
+      for (auto const &dir_entry : std::filesystem::directory_iterator{ root }) {
+        if (!dir_entry.is_directory()) { continue; }
+        const auto stem = dir_entry.path().stem().string();
+        const auto *known = find(stem);
+        if (known == nullptr) {
+          updated.push_back(scan_folder(stem));
+        } else {
+          updated.push_back(known->mtime == content_mtime(*known) ? *known : rescan(*known));
+        }
+      }
+      entries = std::move(updated);
+      root_mtime = current_mtime;
+      reindex();
+      dirty = true;
+    } else {
+      bool changed = false;
+      for (auto &entry : entries) {
+        if (entry.mtime == content_mtime(entry)) { continue; }
+        entry = rescan(entry);
+        changed = true;
+      }
+      if (changed) {
+        ++change_count;
+        dirty = true;
+      }
+    }
+    if (dirty) { save(); }
+  }
+
+  // Re-reads a single song folder, e.g. after a map was saved or a music file was added to it.
+  const LibraryEntry &update(const std::string &stem)
+  {
+    auto entry = scan_folder(stem);
+    if (const auto it = by_stem.find(stem); it != by_stem.end()) {
+      entry.stats = entries[it->second].stats;
+      entries[it->second] = std::move(entry);
+      ++change_count;
+    } else {
+      entries.push_back(std::move(entry));
+      reindex();
+    }
+    save();
+    return entries[by_stem.at(stem)];
+  }
+
+  // Stores freshly computed stats; the index is written by the caller once a whole batch is in.
+  void set_stats(const std::string &stem, const MapStats &stats)
+  {
+    const auto it = by_stem.find(stem);
+    if (it == by_stem.end()) { return; }
+    entries[it->second].stats = stats;
+    dirty = true;
+    ++stats_change_count;
+  }
+
+  void save_if_dirty()
+  {
+    if (dirty) { save(); }
+  }
+
+  [[nodiscard]] const LibraryEntry *find(const std::string &stem) const
+  {
+    const auto it = by_stem.find(stem);
+    return it == by_stem.end() ? nullptr : &entries[it->second];
+  }
+
+  [[nodiscard]] const std::vector<LibraryEntry> &songs() const noexcept { return entries; }
+  // Changes whenever songs() may have changed, so derived data knows when to rebuild.
+  [[nodiscard]] std::size_t revision() const noexcept { return change_count; }
+  // Changes whenever the stats of a song changed without the song list itself changing.
+  [[nodiscard]] std::size_t stats_revision() const noexcept { return stats_change_count; }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "library.hpp"
+#include "map_stats.hpp"
+#include "song.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+// Computes the MapStats of every song on a background thread, spreading the maps over a thread pool. A map is
+// only loaded when its mtime or size differ from the ones its cached stats were computed from. The results are
+// handed to the library on the UI thread by apply(), so the menu never waits for the disk.
+class LibraryAnalysis
+{
+  struct Job
+  {
+    std::string stem;
+    std::string map_path;
+    MapStats cached;
+    // stays unanalyzed when the cached stats are still current
+    MapStats result;
+  };
+
+  std::vector<Job> jobs;
+  std::thread worker;
+  std::atomic<bool> done = false;
+  std::atomic<bool> stopping = false;
+
+  void analyze(Job &job) const
+  {
+    if (stopping) { return; }
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(job.map_path, ec);
+    if (ec) { return; }
+    const auto mtime = SongLibrary::mtime_of(job.map_path);
+    if (job.cached.analyzed && job.cached.map_mtime == mtime && job.cached.map_size == size) { return; }
+
+    job.result = compute_map_stats(load_song_from_disk(job.stem).notes);
+    job.result.map_mtime = mtime;
+    job.result.map_size = size;
+  }
+
+  void stop()
+  {
+    stopping = true;
+    if (worker.joinable()) { worker.join(); }
+    stopping = false;
+  }
+
+public:
+  LibraryAnalysis() = default;
+  LibraryAnalysis(const LibraryAnalysis &) = delete;
+  LibraryAnalysis &operator=(const LibraryAnalysis &) = delete;
+  ~LibraryAnalysis() { stop(); }
+
+  // Starts a pass over the songs of `library` unless one is still running. A finished pass that was not applied
+  // yet is applied first, so its results are not computed again. `finished` is called from the worker thread.
+  void start(SongLibrary &library, std::function<void()> finished)
+  {
+    if (running()) { return; }
+    apply(library);
+    stop();
+    jobs.clear();
+    const auto &songs = library.songs();
+    jobs.reserve(songs.size());
+    for (const auto &entry : songs) { jobs.push_back({ entry.stem, entry.map_path, entry.stats, {} }); }
+    done = false;
+    worker = std::thread{ [this, finished = std::move(finished)] {
+      {
+        TRACE_SCOPE("library analysis");
+        ThreadPool pool;
+        pool.for_each_index(jobs.size(), [&](const std::size_t i) { analyze(jobs[i]); });
+      }
+      done = true;
+      finished();
+    } };
+  }
+
+  [[nodiscard]] bool running() const noexcept { return worker.joinable() && !done; }
+
+  // Hands the stats of a finished pass to `library`. Returns whether any song's stats changed.
+  bool apply(SongLibrary &library)
+  {
+    if (!worker.joinable() || !done) { return false; }
+    worker.join();
+    bool changed = false;
+    for (const auto &job : jobs) {
+      if (!job.result.analyzed) { continue; }
+      library.set_stats(job.stem, job.result);
+      changed = true;
+    }
+    jobs.clear();
+    library.save_if_dirty();
+    return changed;
+  }
+};
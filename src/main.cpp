@@ -1,13 +1,65 @@
 #include <fmt/printf.h>
 
+#include <internal_use_only/config.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+
 #include "Game.hpp"
+#include "startup_profile.hpp"
+#include "trace.hpp"
+
+namespace {
+constexpr std::string_view USAGE = R"(Usage: intro [options]
 
-int main()
+Options:
+  --trace <file>       record timing events of the session to <file> as a Chrome trace
+  --profile-startup    show the first frame, then print where the time to it went and exit
+  --version            print the version and exit
+  --help               print this help and exit
+)";
+}
+
+int main(int argc, char *argv[])
 {
   try {
-    Game game;
+    StartupProfile profile;
+    const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+    std::string trace_path;
+    bool profile_startup = false;
+    for (auto arg = args.begin(); arg != args.end(); ++arg) {
+      const std::string_view option{ *arg };
+      if (option == "--help" || option == "-h") {
+        fmt::print("{}", USAGE);
+        return 0;
+      }
+      if (option == "--version") {
+        fmt::print("{} {}\n", consu::cmake::project_name, consu::cmake::project_version);
+        return 0;
+      }
+      if (option == "--profile-startup") {
+        profile_startup = true;
+      } else if (option == "--trace" && std::next(arg) != args.end()) {
+        trace_path = *++arg;
+      } else {
+        fmt::print(stderr, "intro: unknown option '{}'\n\n{}", option, USAGE);
+        return 1;
+      }
+    }
+    profile.mark("arguments");
+
+    auto settings = load_settings();
+    if (!trace_path.empty() || settings.show_trace_overlay) { Trace::enable(); }
+    profile.mark("settings");
+    {
+      Game game{ std::move(settings), profile_startup ? &profile : nullptr };
+    }
+    if (profile_startup) { fmt::print("{}", profile.report()); }
+    if (!trace_path.empty()) { Trace::write_chrome_json(trace_path); }
   } catch (const std::exception &e) {
     fmt::print("Unhandled exception in main: {}", e.what());
+    return 1;
   }
 
   return 0;
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "constants.hpp"
+#include "durable_file.hpp"
+#include "mapped_file.hpp"
+#include "note_track.hpp"
+#include "song.hpp"
+#include "spsc_queue.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+
+// Journal layout (little-endian): JournalHeader, then one JournalRecord per recorded note. A crash can only
+// tear the last record, which recovery drops.
+struct JournalHeader
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+};
+
+struct JournalRecord
+{
+  NoteTrack::Time time;
+  NoteTrack::Coordinate x;
+  NoteTrack::Coordinate y;
+};
+
+static_assert(sizeof(JournalHeader) == 8 && std::is_trivially_copyable_v<JournalHeader>);
+static_assert(sizeof(JournalRecord) == 8 && std::is_trivially_copyable_v<JournalRecord>);
+
+// Append-only log of the notes of a mapping session. The editor hands notes over through a queue; a background
+// thread writes them in batches and syncs the file every SYNC_INTERVAL, so a crash or a dropped SSH session
+// loses at most that much of the recording. The journal is kept until discard(), so a session that never got
+// saved is recovered by recover_journals() on the next start.
+class MapJournal
+{
+  SpscQueue<Note, JOURNAL_CONSTANTS::QUEUE_SIZE> queue;
+  std::string path;
+  DurableFile file;
+  std::mutex wake_mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread writer;
+
+  // Writes everything queued so far as one batch; returns whether there was anything to write.
+  bool write_batch(std::vector<JournalRecord> &batch)
+  {
+    batch.clear();
+    Note note{};
+    while (queue.pop(note)) {
+      batch.push_back({ NoteTrack::to_time(note.timestamp), NoteTrack::to_coordinate(note.x),
+        NoteTrack::to_coordinate(note.y) });
+    }
+    if (batch.empty()) { return false; }
+    TRACE_SCOPE("journal write");
+    file.write(reinterpret_cast<const char *>(batch.data()), batch.size() * sizeof(JournalRecord));// NOLINT
+    return true;
+  }
+
+  void run()
+  {
+    std::vector<JournalRecord> batch;
+    auto last_sync = std::chrono::steady_clock::now();
+    bool unsynced = false;
+    for (bool done = false; !done;) {
+      {
+        std::unique_lock lock{ wake_mutex };
+        wake.wait_for(lock, JOURNAL_CONSTANTS::FLUSH_INTERVAL, [&] { return stopping; });
+        done = stopping;
+      }
+      unsynced = write_batch(batch) || unsynced;
+      const auto now = std::chrono::steady_clock::now();
+      if (unsynced && (done || now - last_sync >= JOURNAL_CONSTANTS::SYNC_INTERVAL)) {
+        file.sync();
+        last_sync = now;
+        unsynced = false;
+      }
+    }
+  }
+
+public:
+  MapJournal() = default;
+  ~MapJournal() { stop(); }
+
+  MapJournal(const MapJournal &) = delete;
+  MapJournal &operator=(const MapJournal &) = delete;
+  MapJournal(MapJournal &&) = delete;
+  MapJournal &operator=(MapJournal &&) = delete;
+
+  // Starts a new journal for the song, replacing an older one.
+  void start(const std::string &stem)
+  {
+    stop();
+    queue.clear();
+    path = generate_journal_path(stem);
+    file = DurableFile{ path, DurableFile::Mode::Truncate };
+    const JournalHeader header{ JOURNAL_CONSTANTS::MAGIC, JOURNAL_CONSTANTS::VERSION };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));// NOLINT
+    file.sync();
+    stopping = false;
+    writer = std::thread{ [this] { run(); } };
+  }
+
+  // Editor thread. Returns false when the writer fell behind by a whole queue; the note then only exists in
+  // the in-memory song.
+  bool append(const Note &note) noexcept { return queue.push(note); }
+
+  // Writes and syncs whatever is still queued; the journal stays on disk.
+  void stop()
+  {
+    if (!writer.joinable()) { return; }
+    {
+      const std::lock_guard lock{ wake_mutex };
+      stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    file.close();
+  }
+
+  // Called once the recording has been saved as a map.
+  void discard()
+  {
+    stop();
+    std::error_code ec;
+    if (!path.empty()) { std::filesystem::remove(path, ec); }
+    path.clear();
+  }
+};
+
+// Notes of a journal, without a torn last record.
+NoteTrack load_journal(const std::string &path)
+{
+  NoteTrack notes;
+  const MappedFile map{ path };
+  JournalHeader header{};
+  if (map.size() < sizeof(header)) { return notes; }
+  std::memcpy(&header, map.data(), sizeof(header));
+  if (header.magic != JOURNAL_CONSTANTS::MAGIC || header.version != JOURNAL_CONSTANTS::VERSION) { return notes; }
+
+  const auto count = (map.size() - sizeof(header)) / sizeof(JournalRecord);
+  notes.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    JournalRecord record{};
+    std::memcpy(&record, map.data() + sizeof(header) + i * sizeof(JournalRecord), sizeof(record));
+    notes.push_back({ record.x, record.y, record.time });
+  }
+  return notes;
+}
+
+// Turns the journals of interrupted mapping sessions into maps. Returns how many songs were recovered.
+std::size_t recover_journals()
+{
+  std::size_t recovered = 0;
+  for (const auto &stem : get_songs_list()) {
+    const auto journal = generate_journal_path(stem);
+    std::error_code ec;
+    if (!std::filesystem::exists(journal, ec)) { continue; }
+
+    const Song song{ stem, load_journal(journal) };
+    if (song.notes.empty() || save_song_to_disk(song)) {
+      std::filesystem::remove(journal, ec);
+      if (!song.notes.empty()) { ++recovered; }
+    }
+  }
+  return recovered;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "constants.hpp"
+#include "note_track.hpp"
+
+// Difficulty figures of a map, together with the size and mtime of the map file they were computed from.
+struct MapStats
+{
+  bool analyzed = false;
+  std::int64_t map_mtime = 0;
+  std::uint64_t map_size = 0;
+  long long duration_ms = 0;
+  std::size_t note_count = 0;
+  double peak_notes_per_second = 0;
+  // mean distance between consecutive notes, in canvas pixels
+  double average_jump = 0;
+};
+
+MapStats compute_map_stats(const NoteTrack &notes)
+{
+  MapStats stats;
+  stats.analyzed = true;
+  stats.note_count = notes.size();
+  if (notes.empty()) { return stats; }
+  stats.duration_ms = notes.time(notes.size() - 1);
+
+  // densest one-second window, with two cursors over the sorted times
+  std::size_t window_start = 0;
+  std::size_t densest = 0;
+  double jumps = 0;
+  for (std::size_t i = 0; i < notes.size(); ++i) {
+    while (notes.time(i) - notes.time(window_start) >= 1000) { ++window_start; }
+    densest = std::max(densest, i - window_start + 1);
+    if (i > 0) {
+      const auto dx = (notes.x(i) - notes.x(i - 1)) * CANVAS_CONSTANTS::RATIO_FIX[0];
+      const auto dy = (notes.y(i) - notes.y(i - 1)) * CANVAS_CONSTANTS::RATIO_FIX[1];
+      jumps += std::hypot(dx, dy);
+    }
+  }
+  stats.peak_notes_per_second = static_cast<double>(densest);
+  stats.average_jump = notes.size() > 1 ? jumps / static_cast<double>(notes.size() - 1) : 0.0;
+  return stats;
+}
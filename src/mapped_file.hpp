@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. An empty or missing file yields an unmapped object.
+class MappedFile
+{
+  const std::byte *begin = nullptr;
+  std::size_t length = 0;
+
+  void unmap() noexcept
+  {
+    if (begin == nullptr) { return; }
+#ifdef _WIN32
+    UnmapViewOfFile(begin);
+#else
+    munmap(const_cast<std::byte *>(begin), length);// NOLINT(cppcoreguidelines-pro-type-const-cast)
+#endif
+    begin = nullptr;
+    length = 0;
+  }
+
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path)
+  {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return; }
+    LARGE_INTEGER file_size{};
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping != nullptr) {
+        begin = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (begin != nullptr) { length = static_cast<std::size_t>(file_size.QuadPart); }
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+#else
+    const int fd = open(path.c_str(), O_RDONLY);// NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (fd < 0) { return; }
+    struct stat st
+    {
+    };
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      const auto file_size = static_cast<std::size_t>(st.st_size);
+      void *addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {// NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+        begin = static_cast<const std::byte *>(addr);
+        length = file_size;
+      }
+    }
+    close(fd);
+#endif
+  }
+  ~MappedFile() { unmap(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept
+    : begin{ std::exchange(other.begin, nullptr) }, length{ std::exchange(other.length, 0) }
+  {}
+  MappedFile &operator=(MappedFile &&other) noexcept
+  {
+    if (this != &other) {
+      unmap();
+      begin = std::exchange(other.begin, nullptr);
+      length = std::exchange(other.length, 0);
+    }
+    return *this;
+  }
+
+  [[nodiscard]] bool is_open() const noexcept { return begin != nullptr; }
+  [[nodiscard]] const std::byte *data() const noexcept { return begin; }
+  [[nodiscard]] std::size_t size() const noexcept { return length; }
+};
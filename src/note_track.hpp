@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+struct Note
+{
+  int x;
+  int y;
+  long long timestamp;
+};
+
+// Notes of a song as parallel arrays: 4-byte times and 2-byte coordinates, 8 bytes per note instead of 16.
+// Scanning for the notes of a time window reads only the times; positions are read for the few notes found.
+// Times must be non-decreasing, which is how maps are recorded.
+class NoteTrack
+{
+public:
+  using Time = std::int32_t;
+  using Coordinate = std::int16_t;
+
+private:
+  std::vector<Time> times;
+  std::vector<Coordinate> xs;
+  std::vector<Coordinate> ys;
+
+public:
+  // Out-of-range values are clamped to the compact types.
+  static Time to_time(const long long ms) noexcept
+  {
+    return static_cast<Time>(
+      std::clamp<long long>(ms, std::numeric_limits<Time>::min(), std::numeric_limits<Time>::max()));
+  }
+  static Coordinate to_coordinate(const int value) noexcept
+  {
+    return static_cast<Coordinate>(
+      std::clamp<int>(value, std::numeric_limits<Coordinate>::min(), std::numeric_limits<Coordinate>::max()));
+  }
+
+  // Yields notes by value, so range-for loops keep working on the split storage.
+  class const_iterator
+  {
+    const NoteTrack *track = nullptr;
+    std::size_t index = 0;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Note;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Note;
+
+    const_iterator() = default;
+    const_iterator(const NoteTrack *notes, const std::size_t at) : track{ notes }, index{ at } {}
+
+    Note operator*() const { return (*track)[index]; }
+    const_iterator &operator++()
+    {
+      ++index;
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      auto previous = *this;
+      ++index;
+      return previous;
+    }
+    bool operator==(const const_iterator &other) const noexcept { return index == other.index; }
+  };
+
+  NoteTrack() = default;
+
+  void reserve(const std::size_t count)
+  {
+    times.reserve(count);
+    xs.reserve(count);
+    ys.reserve(count);
+  }
+  void resize(const std::size_t count)
+  {
+    times.resize(count);
+    xs.resize(count);
+    ys.resize(count);
+  }
+  void clear() noexcept
+  {
+    times.clear();
+    xs.clear();
+    ys.clear();
+  }
+  void push_back(const Note &note)
+  {
+    times.push_back(to_time(note.timestamp));
+    xs.push_back(to_coordinate(note.x));
+    ys.push_back(to_coordinate(note.y));
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return times.size(); }
+  [[nodiscard]] bool empty() const noexcept { return times.empty(); }
+
+  [[nodiscard]] long long time(const std::size_t i) const noexcept { return times[i]; }
+  [[nodiscard]] int x(const std::size_t i) const noexcept { return xs[i]; }
+  [[nodiscard]] int y(const std::size_t i) const noexcept { return ys[i]; }
+  [[nodiscard]] Note operator[](const std::size_t i) const noexcept { return { xs[i], ys[i], times[i] }; }
+  [[nodiscard]] Note back() const noexcept { return (*this)[size() - 1]; }
+
+  [[nodiscard]] const_iterator begin() const noexcept { return { this, 0 }; }
+  [[nodiscard]] const_iterator end() const noexcept { return { this, size() }; }
+
+  // Raw columns, e.g. for writing them to disk.
+  [[nodiscard]] Time *time_data() noexcept { return times.data(); }
+  [[nodiscard]] Coordinate *x_data() noexcept { return xs.data(); }
+  [[nodiscard]] Coordinate *y_data() noexcept { return ys.data(); }
+  [[nodiscard]] const Time *time_data() const noexcept { return times.data(); }
+  [[nodiscard]] const Coordinate *x_data() const noexcept { return xs.data(); }
+  [[nodiscard]] const Coordinate *y_data() const noexcept { return ys.data(); }
+
+  // Index of the first note at or after `time_ms`.
+  [[nodiscard]] std::size_t first_at_or_after(const long long time_ms) const noexcept
+  {
+    return static_cast<std::size_t>(std::lower_bound(times.begin(), times.end(), to_time(time_ms)) - times.begin());
+  }
+
+  // Indices [first, last) of the notes with from_ms <= time <= to_ms, found by binary search.
+  [[nodiscard]] std::pair<std::size_t, std::size_t> window(const long long from_ms,
+    const long long to_ms) const noexcept
+  {
+    const auto first = std::lower_bound(times.begin(), times.end(), to_time(from_ms));
+    const auto last = std::upper_bound(first, times.end(), to_time(to_ms));
+    return { static_cast<std::size_t>(first - times.begin()), static_cast<std::size_t>(last - times.begin()) };
+  }
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <libnyquist/Decoders.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <numbers>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "constants.hpp"
+#include "note_track.hpp"
+#include "song.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+#include "wav_reader.hpp"
+
+// Iterative radix-2 FFT over split real and imaginary arrays. Every butterfly stage is a plain loop over
+// contiguous floats with its twiddles laid out next to each other, so the compiler turns it into SIMD code.
+class Fft
+{
+  std::size_t length;
+  std::vector<std::uint32_t> reversed;
+  // twiddles of the stage with butterflies `half` apart live at [half - 1, 2 * half - 1)
+  std::vector<float> twiddle_re;
+  std::vector<float> twiddle_im;
+
+public:
+  // `size` has to be a power of two.
+  explicit Fft(const std::size_t size) : length{ size }, reversed(size), twiddle_re(size - 1), twiddle_im(size - 1)
+  {
+    const auto bits = static_cast<unsigned>(std::countr_zero(size));
+    for (std::uint32_t i = 0; i < size; ++i) {
+      std::uint32_t r = 0;
+      for (unsigned b = 0; b < bits; ++b) { r |= ((i >> b) & 1U) << (bits - 1 - b); }
+      reversed[i] = r;
+    }
+    for (std::size_t half = 1; half < size; half *= 2) {
+      for (std::size_t j = 0; j < half; ++j) {
+        const auto angle = std::numbers::pi * static_cast<double>(j) / static_cast<double>(half);
+        twiddle_re[half - 1 + j] = static_cast<float>(std::cos(angle));
+        twiddle_im[half - 1 + j] = static_cast<float>(-std::sin(angle));
+      }
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return length; }
+
+  void transform(float *re, float *im) const noexcept
+  {
+    for (std::size_t i = 0; i < length; ++i) {
+      if (i < reversed[i]) {
+        std::swap(re[i], re[reversed[i]]);
+        std::swap(im[i], im[reversed[i]]);
+      }
+    }
+    for (std::size_t half = 1; half < length; half *= 2) {
+      const auto *const wr = twiddle_re.data() + half - 1;
+      const auto *const wi = twiddle_im.data() + half - 1;
+      for (std::size_t start = 0; start < length; start += 2 * half) {
+        auto *const ar = re + start;
+        auto *const ai = im + start;
+        auto *const br = ar + half;
+        auto *const bi = ai + half;
+        for (std::size_t j = 0; j < half; ++j) {
+          const auto tr = br[j] * wr[j] - bi[j] * wi[j];
+          const auto ti = br[j] * wi[j] + bi[j] * wr[j];
+          br[j] = ar[j] - tr;
+          bi[j] = ai[j] - ti;
+          ar[j] += tr;
+          ai[j] += ti;
+        }
+      }
+    }
+  }
+};
+
+// Mono samples in [-1, 1], averaged down to about ANALYSIS_RATE.
+struct AnalysisAudio
+{
+  std::vector<float> samples;
+  double rate = 0;
+};
+
+// Mixes interleaved frames down to mono and averages every `factor` of them into one analysis sample.
+class Downmix
+{
+  std::size_t channel_count;
+  std::size_t factor;
+  float scale;
+  double output_rate;
+  float sum = 0;
+  std::size_t summed = 0;
+
+public:
+  // `full_scale` is the magnitude of a full-scale sample: 32768 for 16-bit PCM, 1 for float PCM.
+  Downmix(const int channels, const int sample_rate, const float full_scale)
+    : channel_count{ static_cast<std::size_t>(channels) },
+      factor{ static_cast<std::size_t>(std::max(1, sample_rate / ONSET_CONSTANTS::ANALYSIS_RATE)) },
+      scale{ 1.0F / (full_scale * static_cast<float>(channel_count * factor)) },
+      output_rate{ sample_rate / static_cast<double>(factor) }
+  {}
+
+  [[nodiscard]] std::size_t channels() const noexcept { return channel_count; }
+  [[nodiscard]] std::size_t frames_per_sample() const noexcept { return factor; }
+  [[nodiscard]] double rate() const noexcept { return output_rate; }
+
+  template<typename Sample> void add(const Sample *interleaved, const std::size_t frames, std::vector<float> &out)
+  {
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+      for (std::size_t c = 0; c < channel_count; ++c) { sum += interleaved[frame * channel_count + c]; }
+      if (++summed == factor) {
+        out.push_back(sum * scale);
+        sum = 0;
+        summed = 0;
+      }
+    }
+  }
+};
+
+// WAV is read incrementally by WavReader; any other format libnyquist knows is decoded to float PCM in one go.
+AnalysisAudio read_analysis_audio(const std::string &path)
+{
+  TRACE_SCOPE("onset decode");
+  AnalysisAudio audio;
+  WavReader reader{ path };
+  if (reader.is_open()) {
+    Downmix mix{ reader.channels(), reader.sample_rate(), 32768.0F };
+    audio.rate = mix.rate();
+    audio.samples.reserve(reader.frames() / mix.frames_per_sample() + 1);
+    std::vector<std::int16_t> buffer(ONSET_CONSTANTS::READ_FRAMES * mix.channels());
+    for (auto frames = reader.read(buffer); frames > 0; frames = reader.read(buffer)) {
+      mix.add(buffer.data(), frames, audio.samples);
+    }
+    return audio;
+  }
+
+  nqr::AudioData data;
+  try {
+    nqr::NyquistIO loader;
+    loader.Load(&data, path);
+  } catch (const std::exception &) {
+    return audio;
+  }
+  if (data.channelCount <= 0 || data.sampleRate <= 0) { return audio; }
+  Downmix mix{ data.channelCount, data.sampleRate, 1.0F };
+  audio.rate = mix.rate();
+  const auto frames = data.samples.size() / mix.channels();
+  audio.samples.reserve(frames / mix.frames_per_sample() + 1);
+  mix.add(data.samples.data(), frames, audio.samples);
+  return audio;
+}
+
+// Positive change of the log-compressed magnitude spectrum from one Hann-windowed frame to the next, one value
+// per HOP samples. Two real frames share each complex FFT, one as its real part and one as its imaginary part.
+std::vector<float> spectral_flux(const std::vector<float> &samples)
+{
+  TRACE_SCOPE("spectral flux");
+  constexpr auto N = ONSET_CONSTANTS::FFT_SIZE;
+  constexpr auto HOP = ONSET_CONSTANTS::HOP;
+  constexpr auto BINS = N / 2 + 1;
+  if (samples.size() < N) { return {}; }
+  const auto frame_count = 1 + (samples.size() - N) / HOP;
+
+  const Fft fft{ N };
+  std::vector<float> window(N);
+  for (std::size_t i = 0; i < N; ++i) {
+    window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2 * std::numbers::pi * static_cast<double>(i) / N));
+  }
+
+  std::vector<float> flux(frame_count);
+  std::vector<float> re(N);
+  std::vector<float> im(N);
+  std::vector<float> previous(BINS);
+  std::vector<float> first(BINS);
+  std::vector<float> second(BINS);
+  const auto log_magnitude = [](const float real, const float imaginary) {
+    return std::log1p(ONSET_CONSTANTS::LOG_COMPRESSION * std::sqrt(real * real + imaginary * imaginary));
+  };
+  const auto rise = [](const std::vector<float> &from, const std::vector<float> &to) {
+    float total = 0;
+    for (std::size_t k = 0; k < BINS; ++k) { total += std::max(0.0F, to[k] - from[k]); }
+    return total;
+  };
+
+  for (std::size_t frame = 0; frame < frame_count; frame += 2) {
+    const bool pair = frame + 1 < frame_count;
+    const auto *const a = samples.data() + frame * HOP;
+    const auto *const b = a + HOP;
+    for (std::size_t i = 0; i < N; ++i) {
+      re[i] = a[i] * window[i];
+      im[i] = pair ? b[i] * window[i] : 0.0F;
+    }
+    fft.transform(re.data(), im.data());
+
+    // X = A + iB with A and B the spectra of the real frames: A[k] = (X[k] + X*[N-k]) / 2,
+    // B[k] = (X[k] - X*[N-k]) / 2i
+    for (std::size_t k = 0; k < BINS; ++k) {
+      const auto mirrored = (N - k) & (N - 1);
+      first[k] = log_magnitude(0.5F * (re[k] + re[mirrored]), 0.5F * (im[k] - im[mirrored]));
+      second[k] = log_magnitude(0.5F * (im[k] + im[mirrored]), 0.5F * (re[mirrored] - re[k]));
+    }
+    flux[frame] = frame == 0 ? 0.0F : rise(previous, first);
+    if (pair) {
+      flux[frame + 1] = rise(first, second);
+      std::swap(previous, second);
+    } else {
+      std::swap(previous, first);
+    }
+  }
+  return flux;
+}
+
+// Times in ms of the peaks of `flux` that stand out from their neighbourhood, at least MIN_GAP_MS apart.
+std::vector<long long> pick_onsets(const std::vector<float> &flux, const double rate)
+{
+  std::vector<long long> onsets;
+  if (flux.empty()) { return onsets; }
+  const auto loudest = *std::max_element(flux.begin(), flux.end());
+  if (loudest <= 0) { return onsets; }
+
+  std::vector<double> prefix(flux.size() + 1, 0.0);
+  for (std::size_t t = 0; t < flux.size(); ++t) { prefix[t + 1] = prefix[t] + double{ flux[t] / loudest }; }
+
+  long long last = -ONSET_CONSTANTS::MIN_GAP_MS;
+  for (std::size_t t = 0; t < flux.size(); ++t) {
+    const double value = flux[t] / loudest;
+    const auto peak_from = t - std::min(t, ONSET_CONSTANTS::PEAK_RADIUS);
+    const auto peak_to = std::min(flux.size(), t + ONSET_CONSTANTS::PEAK_RADIUS + 1);
+    if (*std::max_element(flux.begin() + static_cast<std::ptrdiff_t>(peak_from),
+          flux.begin() + static_cast<std::ptrdiff_t>(peak_to))
+        != flux[t]) {
+      continue;
+    }
+
+    const auto mean_from = t - std::min(t, ONSET_CONSTANTS::MEAN_RADIUS);
+    const auto mean_to = std::min(flux.size(), t + ONSET_CONSTANTS::MEAN_RADIUS + 1);
+    const auto mean = (prefix[mean_to] - prefix[mean_from]) / static_cast<double>(mean_to - mean_from);
+    if (value < mean + double{ ONSET_CONSTANTS::THRESHOLD }) { continue; }
+
+    // the frame's centre is the best estimate of where the attack falls inside it
+    const auto centre = static_cast<double>(t * ONSET_CONSTANTS::HOP + ONSET_CONSTANTS::FFT_SIZE / 2);
+    const auto time_ms = std::llround(centre * 1000.0 / rate);
+    if (time_ms - last >= ONSET_CONSTANTS::MIN_GAP_MS) {
+      onsets.push_back(time_ms);
+      last = time_ms;
+    }
+  }
+  return onsets;
+}
+
+// Lays the onsets out as a path over the play field: the longer the gap before a note, the further it is from
+// the previous one, turning by the golden angle each time and bouncing off the borders.
+NoteTrack place_notes(const std::vector<long long> &onsets)
+{
+  constexpr auto width = static_cast<double>(CANVAS_CONSTANTS::SIZE) / CANVAS_CONSTANTS::RATIO_FIX[0];
+  constexpr auto height = static_cast<double>(CANVAS_CONSTANTS::SIZE) / CANVAS_CONSTANTS::RATIO_FIX[1];
+  constexpr double margin = 3;
+  constexpr double golden_angle = 2.399963229728653;
+  const auto bounce = [&](double value, const double high) {
+    if (value < margin) { value = 2 * margin - value; }
+    if (value > high - margin) { value = 2 * (high - margin) - value; }
+    return std::clamp(value, margin, high - margin);
+  };
+
+  NoteTrack notes;
+  notes.reserve(onsets.size());
+  double x = width / 2;
+  double y = height / 2;
+  double angle = 0;
+  long long previous = onsets.empty() ? 0 : onsets.front();
+  for (const auto time : onsets) {
+    const auto distance = std::clamp(static_cast<double>(time - previous) / 25.0, 3.0, 20.0);
+    previous = time;
+    angle += golden_angle;
+    // cells are about twice as tall as wide
+    x = bounce(x + std::cos(angle) * distance, width);
+    y = bounce(y + std::sin(angle) * distance / 2, height);
+    notes.push_back({ static_cast<int>(std::lround(x)), static_cast<int>(std::lround(y)), time });
+  }
+  return notes;
+}
+
+std::vector<long long> detect_onsets(const std::string &audio_path)
+{
+  const auto audio = read_analysis_audio(audio_path);
+  return pick_onsets(spectral_flux(audio.samples), audio.rate);
+}
+
+// Map of a song folder generated from the music file in it. A file no decoder can read yields a song without
+// notes.
+Song generate_song(const std::string &stem)
+{
+  Song song{ stem, {} };
+  const auto audio_file = find_song(stem);
+  if (audio_file.empty()) { return song; }
+  song.notes = place_notes(detect_onsets(fmt::format("{}/{}", generate_folder_path(stem), audio_file)));
+  return song;
+}
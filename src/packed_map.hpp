@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONSU_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "constants.hpp"
+#include "note_track.hpp"
+
+// Packed map layout (little-endian): PackedMapHeader, song name padded to ALIGNMENT, then one block per
+// BLOCK_NOTES notes. A block is a PackedBlockHeader followed by three bit-packed columns of BLOCK_NOTES values:
+// zigzag-encoded time deltas, x - min_x and y - min_y. The last block is padded with zeros.
+//
+// A column of width b is 4 * b 32-bit words in four interleaved lanes: value v lives in lane v % 4, as the
+// (v / 4)-th b-bit field of that lane's words. One 128-bit load then yields the same field of four consecutive
+// values, so the SSE2 decoder unpacks four notes per instruction and the scalar one runs the same arithmetic.
+struct PackedMapHeader
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint64_t note_count;
+  std::uint32_t name_length;
+  std::uint32_t block_notes;
+};
+
+struct PackedBlockHeader
+{
+  NoteTrack::Time first_time;
+  NoteTrack::Coordinate min_x;
+  NoteTrack::Coordinate min_y;
+  std::uint8_t time_bits;
+  std::uint8_t x_bits;
+  std::uint8_t y_bits;
+  std::array<std::uint8_t, 5> reserved;
+};
+
+static_assert(sizeof(PackedMapHeader) == 24 && std::is_trivially_copyable_v<PackedMapHeader>);
+static_assert(sizeof(PackedBlockHeader) == 16 && std::is_trivially_copyable_v<PackedBlockHeader>);
+
+using PackedColumn = std::array<std::uint32_t, PACKED_MAP_CONSTANTS::BLOCK_NOTES>;
+
+constexpr std::size_t packed_column_words(const unsigned bits) noexcept
+{
+  return PACKED_MAP_CONSTANTS::BLOCK_NOTES * bits / 32;
+}
+
+constexpr std::size_t packed_block_bytes(const PackedBlockHeader &block) noexcept
+{
+  return sizeof(PackedBlockHeader)
+         + (packed_column_words(block.time_bits) + packed_column_words(block.x_bits)
+             + packed_column_words(block.y_bits))
+             * sizeof(std::uint32_t);
+}
+
+void pack_column(const PackedColumn &values, const unsigned bits, std::uint32_t *words) noexcept
+{
+  std::fill(words, words + packed_column_words(bits), 0U);
+  for (std::size_t v = 0; v < values.size(); ++v) {
+    const auto lane = v % 4;
+    const auto offset = v / 4 * bits;
+    const auto word = offset / 32;
+    const auto shift = offset % 32;
+    words[4 * word + lane] |= values[v] << shift;
+    if (shift + bits > 32) { words[4 * (word + 1) + lane] |= values[v] >> (32 - shift); }
+  }
+}
+
+void unpack_column_scalar(const std::uint32_t *words, const unsigned bits, PackedColumn &values) noexcept
+{
+  if (bits == 0) {
+    values.fill(0);
+    return;
+  }
+  const auto mask = bits == 32 ? ~0U : (1U << bits) - 1;
+  for (std::size_t v = 0; v < values.size(); ++v) {
+    const auto lane = v % 4;
+    const auto offset = v / 4 * bits;
+    const auto word = offset / 32;
+    const auto shift = offset % 32;
+    auto value = words[4 * word + lane] >> shift;
+    if (shift + bits > 32) { value |= words[4 * (word + 1) + lane] << (32 - shift); }
+    values[v] = value & mask;
+  }
+}
+
+// Times from zigzag deltas: a running sum starting at `first`, in wrapping 32-bit arithmetic like the encoder.
+void decode_times_scalar(PackedColumn &values, const std::uint32_t first) noexcept
+{
+  auto time = first;
+  for (auto &value : values) {
+    time += (value >> 1U) ^ (0U - (value & 1U));
+    value = time;
+  }
+}
+
+#ifdef CONSU_HAS_SSE2
+void unpack_column_sse2(const std::uint32_t *words, const unsigned bits, PackedColumn &values) noexcept
+{
+  if (bits == 0) {
+    values.fill(0);
+    return;
+  }
+  const auto mask = _mm_set1_epi32(static_cast<int>(bits == 32 ? ~0U : (1U << bits) - 1));
+  const auto *const lanes = reinterpret_cast<const __m128i *>(words);// NOLINT
+  for (std::size_t group = 0; group < values.size() / 4; ++group) {
+    const auto offset = group * bits;
+    const auto word = offset / 32;
+    const auto shift = static_cast<int>(offset % 32);
+    auto value = _mm_srl_epi32(_mm_loadu_si128(lanes + word), _mm_cvtsi32_si128(shift));
+    if (shift + static_cast<int>(bits) > 32) {
+      value = _mm_or_si128(value, _mm_sll_epi32(_mm_loadu_si128(lanes + word + 1), _mm_cvtsi32_si128(32 - shift)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values.data() + 4 * group), _mm_and_si128(value, mask));// NOLINT
+  }
+}
+
+void decode_times_sse2(PackedColumn &values, const std::uint32_t first) noexcept
+{
+  const auto one = _mm_set1_epi32(1);
+  auto carry = _mm_set1_epi32(static_cast<int>(first));
+  auto *const lanes = reinterpret_cast<__m128i *>(values.data());// NOLINT
+  for (std::size_t group = 0; group < values.size() / 4; ++group) {
+    auto value = _mm_loadu_si128(lanes + group);
+    const auto sign = _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one));
+    value = _mm_xor_si128(_mm_srli_epi32(value, 1), sign);
+    // inclusive prefix sum of the four lanes, then the running total of the previous groups
+    value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+    value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+    value = _mm_add_epi32(value, carry);
+    carry = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_storeu_si128(lanes + group, value);
+  }
+}
+#endif
+
+void unpack_column(const std::uint32_t *words, const unsigned bits, PackedColumn &values) noexcept
+{
+#ifdef CONSU_HAS_SSE2
+  unpack_column_sse2(words, bits, values);
+#else
+  unpack_column_scalar(words, bits, values);
+#endif
+}
+
+void decode_times(PackedColumn &values, const std::uint32_t first) noexcept
+{
+#ifdef CONSU_HAS_SSE2
+  decode_times_sse2(values, first);
+#else
+  decode_times_scalar(values, first);
+#endif
+}
+
+// Appends the packed blocks of `notes` to `out`.
+void pack_notes(const NoteTrack &notes, std::vector<char> &out)
+{
+  constexpr auto BLOCK = PACKED_MAP_CONSTANTS::BLOCK_NOTES;
+  PackedColumn times{};
+  PackedColumn xs{};
+  PackedColumn ys{};
+  std::vector<std::uint32_t> words(packed_column_words(32));
+  for (std::size_t first = 0; first < notes.size(); first += BLOCK) {
+    const auto count = std::min(BLOCK, notes.size() - first);
+    PackedBlockHeader block{ notes.time_data()[first], notes.x_data()[first], notes.y_data()[first], 0, 0, 0, {} };
+    for (std::size_t i = first; i < first + count; ++i) {
+      block.min_x = std::min(block.min_x, notes.x_data()[i]);
+      block.min_y = std::min(block.min_y, notes.y_data()[i]);
+    }
+
+    auto previous = static_cast<std::uint32_t>(block.first_time);
+    times.fill(0);
+    xs.fill(0);
+    ys.fill(0);
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto time = static_cast<std::uint32_t>(notes.time_data()[first + i]);
+      const auto delta = time - previous;
+      previous = time;
+      times[i] = (delta << 1U) ^ (0U - (delta >> 31U));
+      xs[i] = static_cast<std::uint32_t>(notes.x_data()[first + i] - block.min_x);
+      ys[i] = static_cast<std::uint32_t>(notes.y_data()[first + i] - block.min_y);
+    }
+    const auto width = [](const PackedColumn &values) {
+      return static_cast<std::uint8_t>(std::bit_width(*std::max_element(values.begin(), values.end())));
+    };
+    block.time_bits = width(times);
+    block.x_bits = width(xs);
+    block.y_bits = width(ys);
+
+    const auto at = out.size();
+    out.resize(at + packed_block_bytes(block));
+    std::memcpy(out.data() + at, &block, sizeof(block));
+    auto *column = out.data() + at + sizeof(block);
+    for (const auto &[values, bits] : { std::pair{ &times, block.time_bits },
+           std::pair{ &xs, block.x_bits },
+           std::pair{ &ys, block.y_bits } }) {
+      pack_column(*values, bits, words.data());
+      std::memcpy(column, words.data(), packed_column_words(bits) * sizeof(std::uint32_t));
+      column += packed_column_words(bits) * sizeof(std::uint32_t);
+    }
+  }
+}
+
+// Decodes `note_count` notes from the blocks in [data, data + size) into `notes`. Returns false on truncated or
+// malformed blocks.
+bool unpack_notes(const std::byte *data, const std::size_t size, const std::size_t note_count, NoteTrack &notes)
+{
+  constexpr auto BLOCK = PACKED_MAP_CONSTANTS::BLOCK_NOTES;
+  notes.resize(note_count);
+  PackedColumn values{};
+  std::vector<std::uint32_t> words(packed_column_words(32));
+  std::size_t at = 0;
+  for (std::size_t first = 0; first < note_count; first += BLOCK) {
+    PackedBlockHeader block{};
+    if (size - at < sizeof(block)) { return false; }
+    std::memcpy(&block, data + at, sizeof(block));
+    if (block.time_bits > 32 || block.x_bits > 32 || block.y_bits > 32 || size - at < packed_block_bytes(block)) {
+      return false;
+    }
+
+    const auto count = std::min(BLOCK, note_count - first);
+    const auto *column = data + at + sizeof(block);
+    const auto next_column = [&](const unsigned bits) {
+      std::memcpy(words.data(), column, packed_column_words(bits) * sizeof(std::uint32_t));
+      column += packed_column_words(bits) * sizeof(std::uint32_t);
+      unpack_column(words.data(), bits, values);
+    };
+
+    // coordinates are rebuilt in wrapping 32-bit arithmetic, then narrowed back to 16 bits
+    const auto min_x = static_cast<std::uint32_t>(block.min_x);
+    const auto min_y = static_cast<std::uint32_t>(block.min_y);
+    auto *const times = notes.time_data() + first;
+    auto *const xs = notes.x_data() + first;
+    auto *const ys = notes.y_data() + first;
+
+    next_column(block.time_bits);
+    decode_times(values, static_cast<std::uint32_t>(block.first_time));
+    for (std::size_t i = 0; i < count; ++i) { times[i] = static_cast<NoteTrack::Time>(values[i]); }
+    next_column(block.x_bits);
+    for (std::size_t i = 0; i < count; ++i) { xs[i] = static_cast<NoteTrack::Coordinate>(min_x + values[i]); }
+    next_column(block.y_bits);
+    for (std::size_t i = 0; i < count; ++i) { ys[i] = static_cast<NoteTrack::Coordinate>(min_y + values[i]); }
+    at += packed_block_bytes(block);
+  }
+  return true;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <ftxui/dom/canvas.hpp>
+#include <ftxui/dom/elements.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "constants.hpp"
+#include "judge.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+
+// Points of a note circle relative to its center, rasterized once with the same midpoint ellipse
+// algorithm as ftxui::Canvas::DrawPointCircle.
+struct Sprite
+{
+  std::vector<std::array<int, 2>> points;
+  ftxui::Color color;
+};
+
+Sprite rasterize_circle(const int radius, const ftxui::Color color)
+{
+  Sprite sprite{ {}, color };
+  const auto add = [&](const int x, const int y) {
+    const std::array<int, 2> point{ x, y };
+    if (std::find(sprite.points.begin(), sprite.points.end(), point) == sprite.points.end()) {
+      sprite.points.push_back(point);
+    }
+  };
+
+  long x = -radius;
+  long y = 0;
+  const long r = radius;
+  long dx = (1 + 2 * x) * r * r;
+  long dy = x * x;
+  long err = dx + dy;
+  do {
+    add(static_cast<int>(-x), static_cast<int>(y));
+    add(static_cast<int>(x), static_cast<int>(y));
+    add(static_cast<int>(x), static_cast<int>(-y));
+    add(static_cast<int>(-x), static_cast<int>(-y));
+    const auto e2 = 2 * err;
+    if (e2 >= dx) {
+      ++x;
+      dx += 2 * r * r;
+      err += dx;
+    }
+    if (e2 <= dy) {
+      dy += 2 * r * r;
+      err += dy;
+      ++y;
+    }
+  } while (x <= 0);
+  while (y++ < r) {
+    add(0, static_cast<int>(y));
+    add(0, static_cast<int>(-y));
+  }
+  return sprite;
+}
+
+// Play field canvas kept between frames. Each frame only the cells covered by the circles of the previous
+// and of the current frame are touched, and every cell is created up front so drawing never allocates.
+class PlayField
+{
+  struct Placed
+  {
+    int x;
+    int y;
+    const Sprite *sprite;
+
+    bool operator==(const Placed &) const = default;
+  };
+
+  ftxui::Canvas canvas{ CANVAS_CONSTANTS::SIZE, CANVAS_CONSTANTS::SIZE };
+  std::array<Sprite, NOTE_COLORS.size()> sprites;
+  std::vector<Placed> drawn;
+  std::vector<Placed> next;
+  ftxui::Element element = ftxui::canvas(&canvas) | ftxui::border;
+
+  [[nodiscard]] const Sprite *sprite_for(const ftxui::Color::Palette256 color) const
+  {
+    const auto it = std::find(NOTE_COLORS.begin(), NOTE_COLORS.end(), color);
+    return &sprites.at(static_cast<std::size_t>(it - NOTE_COLORS.begin()));
+  }
+
+  void blit(const Placed &placed, const bool value)
+  {
+    for (const auto &[dx, dy] : placed.sprite->points) {
+      canvas.DrawPoint(placed.x + dx, placed.y + dy, value, placed.sprite->color);
+    }
+  }
+
+public:
+  PlayField()
+  {
+    for (std::size_t i = 0; i < NOTE_COLORS.size(); ++i) {
+      sprites.at(i) = rasterize_circle(CANVAS_CONSTANTS::CIRCLE_DIAMETER, NOTE_COLORS.at(i));
+    }
+    for (int y = 0; y < canvas.height(); y += 4) {
+      for (int x = 0; x < canvas.width(); x += 2) { canvas.DrawPoint(x, y, false); }
+    }
+  }
+
+  void clear()
+  {
+    for (const auto &placed : drawn) { blit(placed, false); }
+    drawn.clear();
+  }
+
+  // Draws every unjudged note that is due within the display window, however many there are.
+  void update(const NoteTrack &notes, const JudgedNotes &judged, const long long time_ms)
+  {
+    next.clear();
+    const auto [window_first, window_last] = notes.window(time_ms, time_ms + TIME_CONSTANTS::MAX_TIME_DISPLAY_NOTE);
+    for (auto n = std::max(judged.first_unjudged, window_first); n < window_last; ++n) {
+      if (judged.contains(n)) { continue; }
+      const auto time_to_click = notes.time(n) - time_ms;
+      next.push_back({ notes.x(n) * CANVAS_CONSTANTS::RATIO_FIX[0],
+        notes.y(n) * CANVAS_CONSTANTS::RATIO_FIX[1],
+        sprite_for(time_to_color(time_to_click)) });
+    }
+    if (next == drawn) { return; }
+
+    // overlapping circles share cells, so everything erased is drawn again afterwards
+    for (const auto &placed : drawn) { blit(placed, false); }
+    for (const auto &placed : next) { blit(placed, true); }
+    std::swap(drawn, next);
+  }
+
+  [[nodiscard]] const ftxui::Element &render() const noexcept { return element; }
+};
+
+// Song and score column shown next to the play field.
+ftxui::Element play_sidebar(const std::string &song_name,
+  const Score &score,
+  const char *last_hit,
+  ftxui::Element stats)
+{
+  return ftxui::vbox({
+    ftxui::text(fmt::format("SONG NAME: {}", song_name)),
+    ftxui::text(" "),
+    ftxui::text(fmt::format("POINTS: {}", score.points)),
+    ftxui::text(" "),
+    ftxui::text(fmt::format("LAST HIT: {}", last_hit)),
+    ftxui::text(" "),
+    ftxui::text(fmt::format("CURRENT COMBO: {}", score.combo)),
+    ftxui::text(" "),
+    ftxui::text(fmt::format("MAX COMBO: {}", score.max_combo)),
+    std::move(stats),
+  });
+}
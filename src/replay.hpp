@@ -0,0 +1,121 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "constants.hpp"
+#include "durable_file.hpp"
+#include "judge.hpp"
+#include "mapped_file.hpp"
+#include "types.hpp"
+
+// A play as the stream of clicks that were judged, plus the score the game reported for it.
+struct Replay
+{
+  std::string stem;
+  Score score{};
+  long long end_ms = 0;
+  std::vector<TimedClick> clicks;
+};
+
+// Replay layout (little-endian): ReplayHeader, song stem padded to ALIGNMENT, then click_count packed TimedClicks.
+struct ReplayHeader
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint32_t stem_length;
+  std::uint32_t reserved;
+  std::int64_t end_ms;
+  std::uint64_t click_count;
+  std::uint64_t note_no;
+  std::uint64_t points;
+  std::uint64_t combo;
+  std::uint64_t max_combo;
+};
+
+static_assert(sizeof(ReplayHeader) == 64 && std::is_trivially_copyable_v<ReplayHeader>);
+static_assert(sizeof(TimedClick) == 16 && std::is_trivially_copyable_v<TimedClick>, "replays store clicks as-is");
+
+constexpr std::size_t replay_clicks_offset(const std::size_t stem_length) noexcept
+{
+  const auto unaligned = sizeof(ReplayHeader) + stem_length;
+  return (unaligned + BINARY_MAP_CONSTANTS::ALIGNMENT - 1) / BINARY_MAP_CONSTANTS::ALIGNMENT
+         * BINARY_MAP_CONSTANTS::ALIGNMENT;
+}
+
+// Headless judgement of a replay against the notes of its song: the same rules as a live play, without any
+// rendering, audio or clock.
+Score score_replay(const NoteTrack &notes, const Replay &replay)
+{
+  Judge judge{ notes };
+  for (const auto &click : replay.clicks) { judge.click(click); }
+  judge.expire(replay.end_ms);
+  return judge.current_score();
+}
+
+std::string generate_replay_path(const std::string &stem, const long long recorded_at_ms)
+{
+  return fmt::format("{}/{}/{}{}", FILE_CONSTANTS::REPLAY_FOLDER, stem, recorded_at_ms, FILE_CONSTANTS::REPLAY_EXT);
+}
+
+bool save_replay(const Replay &replay, const std::string &path)
+{
+  const ReplayHeader header{ REPLAY_CONSTANTS::MAGIC,
+    REPLAY_CONSTANTS::VERSION,
+    static_cast<std::uint32_t>(replay.stem.size()),
+    0,
+    replay.end_ms,
+    replay.clicks.size(),
+    replay.score.note_no,
+    replay.score.points,
+    replay.score.combo,
+    replay.score.max_combo };
+
+  const auto clicks_offset = replay_clicks_offset(replay.stem.size());
+  std::vector<char> buffer(clicks_offset + replay.clicks.size() * sizeof(TimedClick));
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  std::memcpy(buffer.data() + sizeof(header), replay.stem.data(), replay.stem.size());
+  if (!replay.clicks.empty()) {
+    std::memcpy(buffer.data() + clicks_offset, replay.clicks.data(), replay.clicks.size() * sizeof(TimedClick));
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path{ path }.parent_path(), ec);
+  if (ec) { return false; }
+  return write_file_atomically(path, buffer.data(), buffer.size());
+}
+
+// Returns a replay without a stem when the file is missing or malformed.
+Replay load_replay(const std::string &path)
+{
+  Replay replay{};
+  const MappedFile file{ path };
+  if (file.size() < sizeof(ReplayHeader)) { return replay; }
+
+  ReplayHeader header{};
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != REPLAY_CONSTANTS::MAGIC || header.version != REPLAY_CONSTANTS::VERSION) { return replay; }
+
+  const auto clicks_offset = replay_clicks_offset(header.stem_length);
+  if (clicks_offset > file.size() || header.click_count > (file.size() - clicks_offset) / sizeof(TimedClick)) {
+    return replay;
+  }
+
+  const std::size_t click_count = header.click_count;
+  replay.stem.assign(reinterpret_cast<const char *>(file.data() + sizeof(header)), header.stem_length);// NOLINT
+  replay.end_ms = header.end_ms;
+  replay.score = { header.note_no, header.points, header.combo, header.max_combo };
+  replay.clicks.resize(click_count);
+  if (!replay.clicks.empty()) {
+    std::memcpy(replay.clicks.data(), file.data() + clicks_offset, replay.clicks.size() * sizeof(TimedClick));
+  }
+  return replay;
+}
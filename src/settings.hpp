@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "constants.hpp"
+#include "types.hpp"
+
+// User settings read from a `key = value` file; `#` starts a comment and unknown keys are ignored.
+struct Settings
+{
+  long long audio_offset_ms = 0;
+  PlaybackMode playback_mode = PlaybackMode::Auto;
+  int target_fps = 120;
+  bool show_frame_stats = false;
+  bool show_trace_overlay = false;
+  OutputMode output_mode = OutputMode::Full;
+  int hitsound_volume = 60;
+  std::size_t audio_cache_mb = AUDIO_CONSTANTS::CACHE_MB;
+};
+
+Settings load_settings(const std::string &path = FILE_CONSTANTS::SETTINGS_PATH)
+{
+  Settings settings{};
+  std::ifstream file{ path };
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    const auto separator = line.find('=');
+    if (separator == std::string::npos) { continue; }
+
+    std::string key;
+    std::string value;
+    std::istringstream{ line.substr(0, separator) } >> key;
+    std::istringstream{ line.substr(separator + 1) } >> value;
+
+    if (key == "audio_offset_ms") {
+      std::istringstream{ value } >> settings.audio_offset_ms;
+    } else if (key == "hitsound_volume") {
+      std::istringstream{ value } >> settings.hitsound_volume;
+    } else if (key == "audio_cache_mb") {
+      long long megabytes = 0;
+      std::istringstream{ value } >> megabytes;
+      settings.audio_cache_mb = static_cast<std::size_t>(std::max(megabytes, 0LL));
+    } else if (key == "target_fps") {
+      std::istringstream{ value } >> settings.target_fps;
+    } else if (key == "show_frame_stats") {
+      settings.show_frame_stats = value == "1" || value == "true";
+    } else if (key == "show_trace_overlay") {
+      settings.show_trace_overlay = value == "1" || value == "true";
+    } else if (key == "output_mode") {
+      settings.output_mode = value == "damage" ? OutputMode::Damage : OutputMode::Full;
+    } else if (key == "playback_mode") {
+      if (value == "buffered") {
+        settings.playback_mode = PlaybackMode::Buffered;
+      } else if (value == "streaming") {
+        settings.playback_mode = PlaybackMode::Streaming;
+      } else {
+        settings.playback_mode = PlaybackMode::Auto;
+      }
+    }
+  }
+  return settings;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "constants.hpp"
+#include "judge.hpp"
+#include "spsc_queue.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+
+// State of a play as published by the simulation; the renderer only ever reads copies of it.
+struct GameSnapshot
+{
+  Score score{};
+  JudgedNotes judged{};
+  const char *last_hit = "";
+  long long time_ms = 0;
+  bool finished = false;
+};
+
+// Clicks on their way from the input thread to the simulation. A click is stamped and queued inside capture(),
+// and while that is in progress the simulation holds back expiry: otherwise a tick that samples the time between
+// the stamp and the push would count the click's note as a miss before it sees the click.
+class ClickQueue
+{
+  SpscQueue<TimedClick, INPUT_CONSTANTS::CLICK_QUEUE_SIZE> queue;
+  std::atomic<bool> capturing = false;
+
+public:
+  // Producer side; `stamp` returns the song time of the click. Drops the click and returns false when full.
+  template<typename Stamp> bool capture(const int x, const int y, Stamp &&stamp)
+  {
+    capturing.store(true);
+    const auto queued = queue.push({ x, y, std::forward<Stamp>(stamp)() });
+    capturing.store(false, std::memory_order_release);
+    return queued;
+  }
+
+  // Consumer side. A click may be stamped but not yet queued; checked after sampling the time and before
+  // draining, a false result means every click stamped before that time is already poppable.
+  [[nodiscard]] bool capture_in_progress() const noexcept { return capturing.load(); }
+
+  // Consumer side.
+  bool pop(TimedClick &click) noexcept { return queue.pop(click); }
+
+  // Consumer side.
+  void clear() noexcept { queue.clear(); }
+};
+
+// Runs the judgement of a play on its own fixed-rate tick, independent of how often frames are drawn.
+class Simulation
+{
+public:
+  using TimeSource = std::function<long long()>;
+  using EndCheck = std::function<bool()>;
+  using FinishCallback = std::function<void()>;
+  // called on the simulation thread for every judged note, including the ones that expired unhit
+  using HitCallback = std::function<void(const Points &)>;
+
+private:
+  Judge judge;
+  std::vector<TimedClick> judged_clicks;
+  ClickQueue *clicks;
+  TimeSource time_source;
+  EndCheck has_ended;
+  FinishCallback on_finished;
+  HitCallback on_hit;
+
+  mutable std::mutex snapshot_mutex;
+  GameSnapshot published{};
+  std::atomic<bool> stopping = false;
+  std::thread ticker;
+
+  void report_misses(const std::size_t missed)
+  {
+    if (!on_hit) { return; }
+    for (std::size_t i = 0; i < missed; ++i) { on_hit(POINT_CONSTANTS::MISS); }
+  }
+
+  void tick()
+  {
+    const auto time_ms = time_source();
+    const auto click_pending = clicks->capture_in_progress();
+    TimedClick click{};
+    while (clicks->pop(click)) {
+      report_misses(judge.expire(click.time_ms));
+      if (const auto points = judge.click(click); points && on_hit) { on_hit(*points); }
+      judged_clicks.push_back(click);
+      if (Trace::enabled()) {
+        // the click was stamped with song time; the same distance back from now is when it was captured
+        const auto now_ns = Trace::now_ns();
+        Trace::record("input latency", now_ns - (time_ms - click.time_ms) * 1'000'000, now_ns);
+      }
+    }
+    // judging every drained click first and never expiring past an undrained one keeps the outcome identical to
+    // judging the clicks in order and expiring once at the end, as score_replay does
+    if (!click_pending) { report_misses(judge.expire(time_ms)); }
+
+    const std::lock_guard lock{ snapshot_mutex };
+    published = {
+      judge.current_score(), judge.judged_notes(), judge.last_hit_msg(), time_ms, !click_pending && has_ended()
+    };
+  }
+
+  void run()
+  {
+    auto next_tick = std::chrono::steady_clock::now();
+    while (!stopping) {
+      tick();
+      if (snapshot().finished) {
+        on_finished();
+        return;
+      }
+      next_tick += TIME_CONSTANTS::SIMULATION_TICK;
+      std::this_thread::sleep_until(next_tick);
+    }
+  }
+
+public:
+  Simulation(const NoteTrack &notes,
+    ClickQueue &click_queue,
+    TimeSource time,
+    EndCheck ended,
+    FinishCallback finished,
+    HitCallback hit = {})
+    : judge{ notes }, clicks{ &click_queue }, time_source{ std::move(time) }, has_ended{ std::move(ended) },
+      on_finished{ std::move(finished) }, on_hit{ std::move(hit) }, ticker{ [this] { run(); } }
+  {}
+  ~Simulation()
+  {
+    stopping = true;
+    ticker.join();
+  }
+
+  Simulation(const Simulation &) = delete;
+  Simulation &operator=(const Simulation &) = delete;
+  Simulation(Simulation &&) = delete;
+  Simulation &operator=(Simulation &&) = delete;
+
+  [[nodiscard]] GameSnapshot snapshot() const
+  {
+    const std::lock_guard lock{ snapshot_mutex };
+    return published;
+  }
+
+  // Every click judged so far, in judgement order. Only complete once a snapshot reported the play finished.
+  [[nodiscard]] const std::vector<TimedClick> &clicks_judged() const noexcept { return judged_clicks; }
+};
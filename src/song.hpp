@@ -1,26 +1,212 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <filesystem>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <string>
 
 #include "types.hpp"
 #include "utils.hpp"
 #include "constants.hpp"
+#include "durable_file.hpp"
+#include "mapped_file.hpp"
+#include "packed_map.hpp"
 
-void save_song_to_disk(const Song& song)
+enum class MapFormat {
+  Text,
+  // uncompressed note columns
+  Binary,
+  // delta and bit-packed blocks, see packed_map.hpp; the smallest, and what the game writes
+  Packed
+};
+
+// Binary map layout (little-endian): MapHeader, song name padded to ALIGNMENT, then the note columns, each
+// padded to ALIGNMENT: note_count int32 times, note_count int16 xs, note_count int16 ys.
+// Version 1 maps instead hold note_count packed 16-byte Notes after the name.
+struct MapHeader
 {
-  std::ofstream file{ generate_map_path(song.name) };
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint64_t note_count;
+  std::uint32_t name_length;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(MapHeader) == 24 && std::is_trivially_copyable_v<MapHeader>);
+static_assert(sizeof(Note) == 16 && std::is_trivially_copyable_v<Note>, "version 1 maps store Note as-is");
 
-  file << song.name << '\n';
-  for (const auto &note : song.notes) { file << note.x << ' ' << note.y << ' ' << note.timestamp << '\n'; }
+constexpr std::size_t align_map_offset(const std::size_t offset) noexcept
+{
+  return (offset + BINARY_MAP_CONSTANTS::ALIGNMENT - 1) / BINARY_MAP_CONSTANTS::ALIGNMENT
+         * BINARY_MAP_CONSTANTS::ALIGNMENT;
 }
 
-Song load_song_from_disk(const std::string &file_name)
+constexpr std::size_t binary_notes_offset(const std::size_t name_length) noexcept
+{
+  return align_map_offset(sizeof(MapHeader) + name_length);
+}
+
+constexpr std::size_t packed_blocks_offset(const std::size_t name_length) noexcept
+{
+  return align_map_offset(sizeof(PackedMapHeader) + name_length);
+}
+
+// Offsets of the x and y columns and the end of the map, relative to binary_notes_offset.
+struct NoteColumns
+{
+  std::size_t xs;
+  std::size_t ys;
+  std::size_t end;
+};
+
+constexpr NoteColumns binary_note_columns(const std::size_t note_count) noexcept
+{
+  const auto xs = align_map_offset(note_count * sizeof(NoteTrack::Time));
+  const auto ys = xs + align_map_offset(note_count * sizeof(NoteTrack::Coordinate));
+  return { xs, ys, ys + note_count * sizeof(NoteTrack::Coordinate) };
+}
+
+bool is_binary_map(const MappedFile &map) noexcept
+{
+  return map.size() >= BINARY_MAP_CONSTANTS::MAGIC.size()
+         && std::memcmp(map.data(), BINARY_MAP_CONSTANTS::MAGIC.data(), BINARY_MAP_CONSTANTS::MAGIC.size()) == 0;
+}
+
+bool is_packed_map(const MappedFile &map) noexcept
 {
-  std::ifstream file{ generate_map_path(file_name) };
+  return map.size() >= PACKED_MAP_CONSTANTS::MAGIC.size()
+         && std::memcmp(map.data(), PACKED_MAP_CONSTANTS::MAGIC.data(), PACKED_MAP_CONSTANTS::MAGIC.size()) == 0;
+}
+
+MapFormat detect_map_format(const std::string &path)
+{
+  const MappedFile map{ path };
+  if (is_packed_map(map)) { return MapFormat::Packed; }
+  return is_binary_map(map) ? MapFormat::Binary : MapFormat::Text;
+}
+
+// The map is built in memory and replaces the old one atomically. Returns false when it could not be written.
+bool save_song_to_disk(const Song &song, const MapFormat format = MapFormat::Packed)
+{
+  if (format == MapFormat::Text) {
+    fmt::memory_buffer text;
+    fmt::format_to(std::back_inserter(text), "{}\n", song.name);
+    for (const auto &note : song.notes) {
+      fmt::format_to(std::back_inserter(text), "{} {} {}\n", note.x, note.y, note.timestamp);
+    }
+    return write_file_atomically(generate_map_path(song.name), text.data(), text.size());
+  }
+  if (format == MapFormat::Packed) {
+    const PackedMapHeader header{ PACKED_MAP_CONSTANTS::MAGIC,
+      PACKED_MAP_CONSTANTS::VERSION,
+      song.notes.size(),
+      static_cast<std::uint32_t>(song.name.size()),
+      PACKED_MAP_CONSTANTS::BLOCK_NOTES };
+    std::vector<char> buffer(packed_blocks_offset(song.name.size()));
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    std::memcpy(buffer.data() + sizeof(header), song.name.data(), song.name.size());
+    pack_notes(song.notes, buffer);
+    return write_file_atomically(generate_map_path(song.name), buffer.data(), buffer.size());
+  }
+
+  const auto count = song.notes.size();
+  const MapHeader header{
+    BINARY_MAP_CONSTANTS::MAGIC, BINARY_MAP_CONSTANTS::VERSION, count, static_cast<std::uint32_t>(song.name.size()), 0
+  };
+  const auto notes_offset = binary_notes_offset(song.name.size());
+  const auto columns = binary_note_columns(count);
+  std::vector<char> buffer(notes_offset + columns.end);
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  std::memcpy(buffer.data() + sizeof(header), song.name.data(), song.name.size());
+  if (count > 0) {
+    auto *const notes = buffer.data() + notes_offset;
+    std::memcpy(notes, song.notes.time_data(), count * sizeof(NoteTrack::Time));
+    std::memcpy(notes + columns.xs, song.notes.x_data(), count * sizeof(NoteTrack::Coordinate));
+    std::memcpy(notes + columns.ys, song.notes.y_data(), count * sizeof(NoteTrack::Coordinate));
+  }
+
+  return write_file_atomically(generate_map_path(song.name), buffer.data(), buffer.size());
+}
+
+Song load_binary_song(const MappedFile &map)
+{
+  Song song{};
+  if (map.size() < sizeof(MapHeader)) { return song; }
+
+  MapHeader header{};
+  std::memcpy(&header, map.data(), sizeof(header));
+  const bool packed = header.version == BINARY_MAP_CONSTANTS::VERSION_PACKED_NOTES;
+  if (header.magic != BINARY_MAP_CONSTANTS::MAGIC || (!packed && header.version != BINARY_MAP_CONSTANTS::VERSION)) {
+    return song;
+  }
+
+  const auto notes_offset = binary_notes_offset(header.name_length);
+  if (notes_offset > map.size()) { return song; }
+  const auto available = map.size() - notes_offset;
+  // bytes per note are at least 8, so this bound also keeps binary_note_columns from overflowing
+  if (header.note_count > available / (packed ? sizeof(Note) : 8)) { return song; }
+
+  const std::size_t note_count = header.note_count;
+  const auto *const notes = map.data() + notes_offset;
+  song.name.assign(reinterpret_cast<const char *>(map.data() + sizeof(header)), header.name_length);// NOLINT
+
+  if (packed) {
+    song.notes.reserve(note_count);
+    for (std::size_t i = 0; i < note_count; ++i) {
+      Note note{};
+      std::memcpy(&note, notes + i * sizeof(Note), sizeof(Note));
+      song.notes.push_back(note);
+    }
+    return song;
+  }
+
+  const auto columns = binary_note_columns(note_count);
+  if (columns.end > available) { return song; }
+  song.notes.resize(note_count);
+  if (note_count > 0) {
+    std::memcpy(song.notes.time_data(), notes, note_count * sizeof(NoteTrack::Time));
+    std::memcpy(song.notes.x_data(), notes + columns.xs, note_count * sizeof(NoteTrack::Coordinate));
+    std::memcpy(song.notes.y_data(), notes + columns.ys, note_count * sizeof(NoteTrack::Coordinate));
+  }
+
+  return song;
+}
+
+Song load_packed_song(const MappedFile &map)
+{
+  Song song{};
+  PackedMapHeader header{};
+  if (map.size() < sizeof(header)) { return song; }
+  std::memcpy(&header, map.data(), sizeof(header));
+  if (header.magic != PACKED_MAP_CONSTANTS::MAGIC || header.version != PACKED_MAP_CONSTANTS::VERSION
+      || header.block_notes != PACKED_MAP_CONSTANTS::BLOCK_NOTES) {
+    return song;
+  }
+
+  const auto blocks_offset = packed_blocks_offset(header.name_length);
+  if (blocks_offset > map.size()) { return song; }
+  const auto available = map.size() - blocks_offset;
+  // every block of up to BLOCK_NOTES notes takes at least its header
+  if (header.note_count / PACKED_MAP_CONSTANTS::BLOCK_NOTES > available / sizeof(PackedBlockHeader)) { return song; }
+
+  NoteTrack notes;
+  if (!unpack_notes(map.data() + blocks_offset, available, header.note_count, notes)) { return song; }
+  song.name.assign(reinterpret_cast<const char *>(map.data() + sizeof(header)), header.name_length);// NOLINT
+  song.notes = std::move(notes);
+  return song;
+}
+
+Song load_text_song(const std::string &path)
+{
+  std::ifstream file{ path };
 
   Song song{};
   std::string line;
@@ -41,14 +227,43 @@ Song load_song_from_disk(const std::string &file_name)
   return song;
 }
 
+Song load_song_from_disk(const std::string &file_name)
+{
+  const auto path = generate_map_path(file_name);
+  const MappedFile map{ path };
+  if (is_packed_map(map)) { return load_packed_song(map); }
+  if (is_binary_map(map)) { return load_binary_song(map); }
+  return load_text_song(path);
+}
+
+
+std::size_t read_note_count(const std::string &path)
+{
+  const MappedFile map{ path };
+  if (is_binary_map(map) || is_packed_map(map)) {
+    // both headers keep the note count at the same place
+    static_assert(offsetof(MapHeader, note_count) == offsetof(PackedMapHeader, note_count));
+    if (map.size() < sizeof(MapHeader)) { return 0; }
+    MapHeader header{};
+    std::memcpy(&header, map.data(), sizeof(header));
+    return header.note_count;
+  }
+  if (!map.is_open()) { return 0; }
+
+  const auto *const text = reinterpret_cast<const char *>(map.data());// NOLINT
+  const auto lines = static_cast<std::size_t>(std::count(text, text + map.size(), '\n'));// NOLINT
+  return lines > 0 ? lines - 1 : 0;
+}
 
-std::string find_song(const Song& song)
+std::string find_song(const std::string &stem)
 {
   const auto is_music_file = [](const std::filesystem::directory_entry &dir_entry) {
-    return dir_entry.is_regular_file() && dir_entry.path().extension() != FILE_CONSTANTS::GAMEFILE_EXT;
+    const auto extension = dir_entry.path().extension();
+    return dir_entry.is_regular_file() && extension != FILE_CONSTANTS::GAMEFILE_EXT
+           && extension != FILE_CONSTANTS::JOURNAL_EXT && extension != FILE_CONSTANTS::TEMP_EXT;
   };
 
-  for (auto const &dir_entry : std::filesystem::directory_iterator{ generate_folder_path(song.name) }) {
+  for (auto const &dir_entry : std::filesystem::directory_iterator{ generate_folder_path(stem) }) {
     if (is_music_file(dir_entry)) {
       return dir_entry.path().filename().string();
     }
@@ -56,6 +271,8 @@ std::string find_song(const Song& song)
   return std::string{};
 }
 
+std::string find_song(const Song &song) { return find_song(song.name); }
+
 std::vector<std::string> get_songs_list()
 {
   std::vector<std::string> stems;
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "library.hpp"
+#include "map_stats.hpp"
+
+enum class SongSort { Relevance = 0, Length, Notes, Density, Jump };
+
+enum class StatField { Length, Notes, Density, Jump };
+
+// One `<field><op><number>` term of a search query, e.g. `nps>=6` or `len<90`.
+struct StatFilter
+{
+  StatField field;
+  // -1 for <, 1 for >, 0 for =; `inclusive` turns < and > into <= and >=
+  int direction;
+  bool inclusive;
+  double value;
+
+  [[nodiscard]] bool accepts(const double stat) const noexcept
+  {
+    if (direction == 0 || (inclusive && stat == value)) { return stat == value; }
+    return direction < 0 ? stat < value : stat > value;
+  }
+};
+
+// A search query split into the words matched against song names and the stat filters.
+struct SongQuery
+{
+  std::string text;
+  std::vector<StatFilter> filters;
+};
+
+// Length in seconds, so that `len<90` reads naturally.
+double stat_value(const MapStats &stats, const StatField field) noexcept
+{
+  switch (field) {
+  case StatField::Length:
+    return static_cast<double>(stats.duration_ms) / 1000.0;
+  case StatField::Notes:
+    return static_cast<double>(stats.note_count);
+  case StatField::Density:
+    return stats.peak_notes_per_second;
+  case StatField::Jump:
+    return stats.average_jump;
+  }
+  return 0;
+}
+
+bool parse_stat_filter(const std::string_view word, StatFilter &filter)
+{
+  constexpr std::array<std::pair<std::string_view, StatField>, 4> fields{ { { "len", StatField::Length },
+    { "notes", StatField::Notes },
+    { "nps", StatField::Density },
+    { "jump", StatField::Jump } } };
+  for (const auto &[name, field] : fields) {
+    if (!word.starts_with(name)) { continue; }
+    auto rest = word.substr(name.size());
+    if (rest.empty() || (rest[0] != '<' && rest[0] != '>' && rest[0] != '=')) { return false; }
+    filter.field = field;
+    filter.direction = rest[0] == '<' ? -1 : (rest[0] == '>' ? 1 : 0);
+    rest.remove_prefix(1);
+    filter.inclusive = filter.direction != 0 && rest.starts_with('=');
+    if (filter.inclusive) { rest.remove_prefix(1); }
+    const auto *const end = rest.data() + rest.size();
+    const auto [parsed_end, ec] = std::from_chars(rest.data(), end, filter.value);
+    return ec == std::errc{} && parsed_end == end;
+  }
+  return false;
+}
+
+SongQuery parse_song_query(const std::string_view query)
+{
+  SongQuery parsed;
+  std::size_t at = 0;
+  while (at < query.size()) {
+    const auto end = std::min(query.find(' ', at), query.size());
+    const auto word = query.substr(at, end - at);
+    at = end + 1;
+    if (word.empty()) { continue; }
+    if (StatFilter filter{}; parse_stat_filter(word, filter)) {
+      parsed.filters.push_back(filter);
+      continue;
+    }
+    if (!parsed.text.empty()) { parsed.text += ' '; }
+    parsed.text += word;
+  }
+  return parsed;
+}
+
+// Keeps the ranked search results that pass every filter, then orders them by `sort`, ascending and with
+// songs not analysed yet last. Songs without stats never pass a filter. Works on cached stats only.
+void filter_and_sort(const std::vector<LibraryEntry> &songs,
+  const std::vector<std::uint32_t> &ranked,
+  const SongQuery &query,
+  const SongSort sort,
+  std::vector<std::uint32_t> &shown)
+{
+  shown.clear();
+  for (const auto id : ranked) {
+    const auto &stats = songs[id].stats;
+    if (std::all_of(query.filters.begin(), query.filters.end(), [&](const StatFilter &filter) {
+          return stats.analyzed && filter.accepts(stat_value(stats, filter.field));
+        })) {
+      shown.push_back(id);
+    }
+  }
+  if (sort == SongSort::Relevance) { return; }
+
+  const auto field = static_cast<StatField>(static_cast<int>(sort) - 1);
+  std::stable_sort(shown.begin(), shown.end(), [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+    const auto &a = songs[lhs].stats;
+    const auto &b = songs[rhs].stats;
+    if (a.analyzed != b.analyzed) { return a.analyzed; }
+    return a.analyzed && stat_value(a, field) < stat_value(b, field);
+  });
+}
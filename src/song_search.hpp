@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "library.hpp"
+
+// Search-as-you-type over the library. Each entry is keyed by its stem and audio file name, lowercased and with
+// `_`, `-` and `.` read as spaces. An entry matches when every word of the query occurs in its key. Results are
+// ranked: matches at the start of the key first, then at the start of a word, then anywhere. Within a rank the
+// library's alphabetical order is kept.
+//
+// A trigram index finds the candidates of a fresh query. A query that extends the previous one only filters the
+// previous matches. Backspace returns to a cached earlier step.
+class SongSearchIndex
+{
+  struct Step
+  {
+    std::string query;
+    // alphabetical, so the next keystroke can filter it and keep the order
+    std::vector<std::uint32_t> matches;
+    std::vector<std::uint32_t> ranked;
+  };
+
+  // every key back to back, so scanning all of them streams through one buffer
+  std::string key_data;
+  std::vector<std::uint32_t> key_offsets;
+  // which characters occur in each key, a cheap rejection test before searching the text
+  std::vector<std::uint64_t> key_masks;
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams;
+  std::vector<std::uint32_t> everything;
+  std::vector<Step> steps;
+  std::array<std::vector<std::uint32_t>, 3> ranks;
+
+  static void normalize_into(std::string &normalized, const std::string_view text)
+  {
+    for (const auto c : text) {
+      const auto u = static_cast<unsigned char>(c);
+      normalized += (c == '_' || c == '-' || c == '.') ? ' ' : static_cast<char>(std::tolower(u));
+    }
+  }
+
+  static std::uint64_t char_mask(const std::string_view text) noexcept
+  {
+    std::uint64_t mask = 0;
+    for (const auto c : text) { mask |= std::uint64_t{ 1 } << (static_cast<unsigned char>(c) % 64U); }
+    return mask;
+  }
+
+  [[nodiscard]] std::string_view key(const std::uint32_t id) const noexcept
+  {
+    return std::string_view{ key_data }.substr(key_offsets[id], key_offsets[id + 1] - key_offsets[id]);
+  }
+
+  static std::uint32_t trigram(const std::string_view text, const std::size_t at) noexcept
+  {
+    return std::uint32_t{ static_cast<unsigned char>(text[at]) } << 16U
+           | std::uint32_t{ static_cast<unsigned char>(text[at + 1]) } << 8U
+           | std::uint32_t{ static_cast<unsigned char>(text[at + 2]) };
+  }
+
+  static std::vector<std::string_view> words(const std::string_view query)
+  {
+    std::vector<std::string_view> split;
+    std::size_t start = 0;
+    while (start < query.size()) {
+      const auto end = std::min(query.find(' ', start), query.size());
+      if (end > start) { split.push_back(query.substr(start, end - start)); }
+      start = end + 1;
+    }
+    return split;
+  }
+
+  // Rank of a key for the query, or ranks.size() when it does not match.
+  [[nodiscard]] std::size_t bucket_of(const std::uint32_t id,
+    const std::vector<std::string_view> &query_words,
+    const std::uint64_t query_mask) const
+  {
+    if ((key_masks[id] & query_mask) != query_mask) { return ranks.size(); }
+    const auto text = key(id);
+    const auto at = text.find(query_words.front());
+    if (at == std::string_view::npos) { return ranks.size(); }
+    for (std::size_t i = 1; i < query_words.size(); ++i) {
+      if (text.find(query_words[i]) == std::string_view::npos) { return ranks.size(); }
+    }
+    return at == 0 ? 0 : text[at - 1] == ' ' ? 1 : 2;
+  }
+
+  // Ids whose key contains every trigram of `word`, which must be at least three characters long.
+  [[nodiscard]] std::vector<std::uint32_t> trigram_candidates(const std::string_view word) const
+  {
+    std::vector<const std::vector<std::uint32_t> *> lists;
+    for (std::size_t i = 0; i + 3 <= word.size(); ++i) {
+      const auto it = trigrams.find(trigram(word, i));
+      if (it == trigrams.end()) { return {}; }
+      lists.push_back(&it->second);
+    }
+    if (lists.empty()) { return {}; }
+    std::sort(lists.begin(), lists.end(), [](auto lhs, auto rhs) { return lhs->size() < rhs->size(); });
+
+    auto candidates = *lists.front();
+    std::vector<std::uint32_t> next;
+    for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+      next.clear();
+      std::set_intersection(
+        candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+      std::swap(candidates, next);
+    }
+    return candidates;
+  }
+
+  // The ids of `base` that match, in base order and ranked; within a rank the base order is kept.
+  Step filter(std::string query,
+    const std::vector<std::uint32_t> &base,
+    const std::vector<std::string_view> &query_words)
+  {
+    std::uint64_t query_mask = 0;
+    for (const auto word : query_words) { query_mask |= char_mask(word); }
+
+    Step step{ std::move(query), {}, {} };
+    for (auto &bucket : ranks) { bucket.clear(); }
+    for (const auto id : base) {
+      const auto bucket = bucket_of(id, query_words, query_mask);
+      if (bucket < ranks.size()) {
+        ranks.at(bucket).push_back(id);
+        step.matches.push_back(id);
+      }
+    }
+    step.ranked.reserve(step.matches.size());
+    for (const auto &bucket : ranks) { step.ranked.insert(step.ranked.end(), bucket.begin(), bucket.end()); }
+    return step;
+  }
+
+public:
+  // Ids are indices into `songs`, which SongLibrary keeps sorted by stem.
+  void build(const std::vector<LibraryEntry> &songs)
+  {
+    key_data.clear();
+    key_offsets.assign(1, 0);
+    key_masks.clear();
+    trigrams.clear();
+    everything.clear();
+    steps.clear();
+    everything.reserve(songs.size());
+
+    for (std::uint32_t id = 0; id < songs.size(); ++id) {
+      const auto &entry = songs[id];
+      normalize_into(key_data, entry.stem);
+      if (!entry.audio_file.empty()) {
+        key_data += ' ';
+        normalize_into(key_data, entry.audio_file);
+      }
+      key_offsets.push_back(static_cast<std::uint32_t>(key_data.size()));
+      everything.push_back(id);
+
+      const auto text = key(id);
+      key_masks.push_back(char_mask(text));
+      for (std::size_t i = 0; i + 3 <= text.size(); ++i) {
+        auto &list = trigrams[trigram(text, i)];
+        if (list.empty() || list.back() != id) { list.push_back(id); }
+      }
+    }
+  }
+
+  const std::vector<std::uint32_t> &search(const std::string_view text)
+  {
+    std::string query;
+    normalize_into(query, text);
+    const auto query_words = words(query);
+    if (query_words.empty()) {
+      steps.clear();
+      return everything;
+    }
+
+    while (!steps.empty() && !query.starts_with(steps.back().query)) { steps.pop_back(); }
+    if (steps.empty() || steps.back().query != query) {
+      const auto longest = std::max_element(
+        query_words.begin(), query_words.end(), [](auto lhs, auto rhs) { return lhs.size() < rhs.size(); });
+      if (!steps.empty()) {
+        steps.push_back(filter(query, steps.back().matches, query_words));
+      } else if (longest->size() >= 3) {
+        steps.push_back(filter(query, trigram_candidates(*longest), query_words));
+      } else {
+        steps.push_back(filter(query, everything, query_words));
+      }
+    }
+    return steps.back().ranked;
+  }
+
+  // Ranked ids of the last search.
+  [[nodiscard]] const std::vector<std::uint32_t> &results() const noexcept
+  {
+    return steps.empty() ? everything : steps.back().ranked;
+  }
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+// Bounded wait-free queue for exactly one producer thread and one consumer thread.
+template<typename T, std::size_t Capacity> class SpscQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  alignas(CACHE_LINE) std::atomic<std::size_t> head = 0;
+  alignas(CACHE_LINE) std::atomic<std::size_t> tail = 0;
+  alignas(CACHE_LINE) std::array<T, Capacity> items{};
+
+public:
+  // Producer side; drops the item and returns false when the queue is full.
+  bool push(const T &item) noexcept
+  {
+    const auto current_tail = tail.load(std::memory_order_relaxed);
+    if (current_tail - head.load(std::memory_order_acquire) == Capacity) { return false; }
+    items[current_tail & (Capacity - 1)] = item;
+    tail.store(current_tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T &item) noexcept
+  {
+    const auto current_head = head.load(std::memory_order_relaxed);
+    if (current_head == tail.load(std::memory_order_acquire)) { return false; }
+    item = items[current_head & (Capacity - 1)];
+    head.store(current_head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  void clear() noexcept { head.store(tail.load(std::memory_order_acquire), std::memory_order_release); }
+};
+
+// SpscQueue whose consumer thread sleeps until something was pushed or the queue was closed.
+template<typename T, std::size_t Capacity> class NotifyingQueue
+{
+  SpscQueue<T, Capacity> queue;
+  std::atomic<bool> pending = false;
+  std::atomic<bool> closed = false;
+
+  void notify() noexcept
+  {
+    pending.store(true, std::memory_order_release);
+    pending.notify_one();
+  }
+
+public:
+  // Producer side; never blocks. Drops the item and returns false when the queue is full.
+  bool push(const T &item) noexcept
+  {
+    if (!queue.push(item)) { return false; }
+    notify();
+    return true;
+  }
+
+  // Consumer side: sleeps until there is something to do, then hands every queued item to `handle`. Returns
+  // false, without draining, once the queue was closed.
+  template<typename Handle> bool wait_and_drain(Handle &&handle)
+  {
+    pending.wait(false, std::memory_order_acquire);
+    // An exchange and not a plain store: a push between the wait and here keeps its flag set for the next
+    // round, and acquiring that flag orders the pops below after the push.
+    pending.exchange(false, std::memory_order_acquire);
+    if (closed) { return false; }
+    T item{};
+    while (queue.pop(item)) { handle(item); }
+    return true;
+  }
+
+  // Wakes the consumer for the last time.
+  void close() noexcept
+  {
+    closed = true;
+    notify();
+  }
+};
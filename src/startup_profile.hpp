@@ -0,0 +1,41 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Time spent in each step from the start of main() to the first frame, for `intro --profile-startup`.
+class StartupProfile
+{
+  using clock = std::chrono::steady_clock;
+
+  clock::time_point start = clock::now();
+  clock::time_point last = start;
+  std::vector<std::pair<std::string_view, double>> phases;
+
+  static double ms(const clock::duration duration)
+  {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+public:
+  // Ends the step named `phase` now.
+  void mark(const std::string_view phase)
+  {
+    const auto now = clock::now();
+    phases.emplace_back(phase, ms(now - last));
+    last = now;
+  }
+
+  [[nodiscard]] std::string report() const
+  {
+    std::string text = "Startup profile\n";
+    for (const auto &[phase, duration] : phases) { text += fmt::format("  {:<24} {:>9.2f} ms\n", phase, duration); }
+    text += fmt::format("  {:<24} {:>9.2f} ms\n", "time to first frame", ms(last - start));
+    return text;
+  }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+// Single-header decoders; every program includes this header from one translation unit only. The dr_libs
+// functions are kept internal so they cannot clash with the copies libnyquist links in through smk.
+#define DRMP3_API static
+#define DRFLAC_API static
+#define DR_MP3_IMPLEMENTATION
+#include <dr_mp3.h>
+#define DR_FLAC_IMPLEMENTATION
+#include <dr_flac.h>
+#include <stb_vorbis.c>
+
+#include "wav_reader.hpp"
+
+// Incremental MP3 decoder with the interface of WavReader.
+class Mp3Reader
+{
+  std::unique_ptr<drmp3> decoder = std::make_unique<drmp3>();
+  bool open = false;
+
+public:
+  explicit Mp3Reader(const std::string &path) : open{ drmp3_init_file(decoder.get(), path.c_str(), nullptr) != 0 }
+  {}
+  ~Mp3Reader()
+  {
+    if (open) { drmp3_uninit(decoder.get()); }
+  }
+
+  Mp3Reader(const Mp3Reader &) = delete;
+  Mp3Reader &operator=(const Mp3Reader &) = delete;
+  Mp3Reader(Mp3Reader &&) = delete;
+  Mp3Reader &operator=(Mp3Reader &&) = delete;
+
+  [[nodiscard]] bool is_open() const noexcept { return open; }
+  [[nodiscard]] int channels() const noexcept { return static_cast<int>(decoder->channels); }
+  [[nodiscard]] int sample_rate() const noexcept { return static_cast<int>(decoder->sampleRate); }
+
+  // Fills `out` with whole interleaved frames and returns how many were read; 0 at the end of the file.
+  std::size_t read(std::span<std::int16_t> out)
+  {
+    if (!open) { return 0; }
+    const auto frames = out.size() / static_cast<std::size_t>(channels());
+    return static_cast<std::size_t>(drmp3_read_pcm_frames_s16(decoder.get(), frames, out.data()));
+  }
+};
+
+// Incremental FLAC decoder with the interface of WavReader.
+class FlacReader
+{
+  drflac *decoder;
+
+public:
+  explicit FlacReader(const std::string &path) : decoder{ drflac_open_file(path.c_str(), nullptr) } {}
+  ~FlacReader()
+  {
+    if (decoder != nullptr) { drflac_close(decoder); }
+  }
+
+  FlacReader(const FlacReader &) = delete;
+  FlacReader &operator=(const FlacReader &) = delete;
+  FlacReader(FlacReader &&) = delete;
+  FlacReader &operator=(FlacReader &&) = delete;
+
+  [[nodiscard]] bool is_open() const noexcept { return decoder != nullptr; }
+  [[nodiscard]] int channels() const noexcept { return decoder->channels; }
+  [[nodiscard]] int sample_rate() const noexcept { return static_cast<int>(decoder->sampleRate); }
+
+  // Fills `out` with whole interleaved frames and returns how many were read; 0 at the end of the file.
+  std::size_t read(std::span<std::int16_t> out)
+  {
+    if (decoder == nullptr) { return 0; }
+    const auto frames = out.size() / static_cast<std::size_t>(channels());
+    return static_cast<std::size_t>(drflac_read_pcm_frames_s16(decoder, frames, out.data()));
+  }
+};
+
+// Incremental Ogg Vorbis decoder with the interface of WavReader. Tracks with more than two channels are mixed
+// down to stereo by the decoder.
+class VorbisReader
+{
+  stb_vorbis *decoder = nullptr;
+  int channel_count = 0;
+  int rate = 0;
+
+public:
+  explicit VorbisReader(const std::string &path)
+  {
+    int error = 0;
+    decoder = stb_vorbis_open_filename(path.c_str(), &error, nullptr);
+    if (decoder == nullptr) { return; }
+    const auto info = stb_vorbis_get_info(decoder);
+    channel_count = std::min(info.channels, 2);
+    rate = static_cast<int>(info.sample_rate);
+  }
+  ~VorbisReader()
+  {
+    if (decoder != nullptr) { stb_vorbis_close(decoder); }
+  }
+
+  VorbisReader(const VorbisReader &) = delete;
+  VorbisReader &operator=(const VorbisReader &) = delete;
+  VorbisReader(VorbisReader &&) = delete;
+  VorbisReader &operator=(VorbisReader &&) = delete;
+
+  [[nodiscard]] bool is_open() const noexcept { return decoder != nullptr && channel_count > 0; }
+  [[nodiscard]] int channels() const noexcept { return channel_count; }
+  [[nodiscard]] int sample_rate() const noexcept { return rate; }
+
+  // Fills `out` with whole interleaved frames and returns how many were read; 0 at the end of the file.
+  std::size_t read(std::span<std::int16_t> out)
+  {
+    if (!is_open()) { return 0; }
+    const auto samples = out.size() - out.size() % static_cast<std::size_t>(channel_count);
+    const auto frames =
+      stb_vorbis_get_samples_short_interleaved(decoder, channel_count, out.data(), static_cast<int>(samples));
+    return static_cast<std::size_t>(std::max(frames, 0));
+  }
+};
+
+// Incremental decoder for every format a song can be streamed from, picked by the file extension. Each read
+// converts only the requested chunk to interleaved 16-bit PCM.
+class StreamReader
+{
+  std::variant<std::monostate, WavReader, Mp3Reader, FlacReader, VorbisReader> reader;
+
+  // `call` on the open decoder, `none` for a format without one.
+  template<typename Variant, typename Call, typename Result>
+  static Result visit(Variant &decoders, Call &&call, const Result none)
+  {
+    return std::visit(
+      [&](auto &decoder) -> Result {
+        if constexpr (std::is_same_v<std::decay_t<decltype(decoder)>, std::monostate>) {
+          return none;
+        } else {
+          return call(decoder);
+        }
+      },
+      decoders);
+  }
+
+public:
+  static std::string extension_of(const std::string &path)
+  {
+    auto extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+    return extension;
+  }
+
+  [[nodiscard]] static bool supports(const std::string &path)
+  {
+    const auto extension = extension_of(path);
+    return extension == ".wav" || extension == ".mp3" || extension == ".flac" || extension == ".ogg";
+  }
+
+  explicit StreamReader(const std::string &path)
+  {
+    const auto extension = extension_of(path);
+    if (extension == ".wav") {
+      reader.emplace<WavReader>(path);
+    } else if (extension == ".mp3") {
+      reader.emplace<Mp3Reader>(path);
+    } else if (extension == ".flac") {
+      reader.emplace<FlacReader>(path);
+    } else if (extension == ".ogg") {
+      reader.emplace<VorbisReader>(path);
+    }
+  }
+
+  [[nodiscard]] bool is_open() const
+  {
+    return visit(reader, [](auto &decoder) { return decoder.is_open(); }, false);
+  }
+  [[nodiscard]] int channels() const
+  {
+    return visit(reader, [](auto &decoder) { return decoder.channels(); }, 0);
+  }
+  [[nodiscard]] int sample_rate() const
+  {
+    return visit(reader, [](auto &decoder) { return decoder.sample_rate(); }, 0);
+  }
+
+  // Fills `out` with whole interleaved frames and returns how many were read; 0 at the end of the file.
+  std::size_t read(std::span<std::int16_t> out)
+  {
+    return visit(reader, [&](auto &decoder) { return decoder.read(out); }, std::size_t{ 0 });
+  }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel batch jobs. The calling thread takes part in every job.
+class ThreadPool
+{
+  using Job = std::function<void(std::size_t)>;
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable job_posted;
+  std::condition_variable job_done;
+  const Job *job = nullptr;
+  std::size_t job_size = 0;
+  std::size_t generation = 0;
+  std::size_t active = 0;
+  bool stopping = false;
+  std::atomic<std::size_t> next_index = 0;
+  std::exception_ptr failure;
+
+  void work(const Job &fn, const std::size_t count)
+  {
+    for (auto i = next_index++; i < count; i = next_index++) {
+      try {
+        fn(i);
+      } catch (...) {
+        const std::lock_guard lock{ mutex };
+        if (!failure) { failure = std::current_exception(); }
+      }
+    }
+  }
+
+  void run()
+  {
+    std::size_t seen = 0;
+    std::unique_lock lock{ mutex };
+    while (true) {
+      job_posted.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping) { return; }
+      seen = generation;
+      if (job == nullptr) { continue; }
+
+      const auto *const current = job;
+      const auto count = job_size;
+      ++active;
+      lock.unlock();
+      work(*current, count);
+      lock.lock();
+      if (--active == 0) { job_done.notify_all(); }
+    }
+  }
+
+public:
+  explicit ThreadPool(const std::size_t threads = std::max(std::thread::hardware_concurrency(), 1U))
+  {
+    workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+      workers.emplace_back([this] { run(); });
+    }
+  }
+  ~ThreadPool()
+  {
+    {
+      const std::lock_guard lock{ mutex };
+      stopping = true;
+    }
+    job_posted.notify_all();
+    for (auto &worker : workers) { worker.join(); }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept { return workers.size() + 1; }
+
+  // Calls fn(i) for every i in [0, count) spread over all threads and returns once all calls finished.
+  // The first exception thrown by fn is rethrown here.
+  void for_each_index(const std::size_t count, const Job &fn)
+  {
+    {
+      const std::lock_guard lock{ mutex };
+      job = &fn;
+      job_size = count;
+      next_index = 0;
+      failure = nullptr;
+      ++generation;
+    }
+    job_posted.notify_all();
+    work(fn, count);
+
+    std::unique_lock lock{ mutex };
+    job_done.wait(lock, [&] { return active == 0; });
+    job = nullptr;
+    if (failure) { std::rethrow_exception(std::exchange(failure, nullptr)); }
+  }
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+
+struct TraceEvent
+{
+  const char *name;
+  std::int64_t start_ns;
+  std::int64_t duration_ns;
+};
+
+struct LatencyPercentiles
+{
+  std::size_t samples = 0;
+  double p50_ms = 0;
+  double p95_ms = 0;
+  double p99_ms = 0;
+};
+
+// Timing events of one thread. Only the owning thread writes; the lock is uncontended except while an overlay
+// or the exporter reads it.
+struct TraceRing
+{
+  std::mutex mutex;
+  std::array<TraceEvent, TRACE_CONSTANTS::RING_EVENTS> events{};
+  std::size_t written = 0;
+  std::uint32_t thread_index = 0;
+
+  void push(const TraceEvent &event)
+  {
+    const std::lock_guard lock{ mutex };
+    events.at(written % events.size()) = event;
+    ++written;
+  }
+
+  template<typename Fn> void for_each(Fn &&fn)
+  {
+    const std::lock_guard lock{ mutex };
+    const auto count = std::min(written, events.size());
+    for (auto i = written - count; i < written; ++i) { fn(events.at(i % events.size())); }
+  }
+};
+
+// Process-wide switch and registry of the per-thread rings. Disabled, a scope costs one relaxed atomic load.
+class Trace
+{
+  using clock = std::chrono::steady_clock;
+
+  static inline std::atomic<bool> active = false;
+  static inline const clock::time_point epoch = clock::now();
+  static inline std::mutex rings_mutex;
+  static inline std::vector<std::unique_ptr<TraceRing>> rings;
+
+  static TraceRing &ring()
+  {
+    // rings are never freed, so events of finished threads can still be exported
+    thread_local TraceRing *const local = [] {
+      const std::lock_guard lock{ rings_mutex };
+      auto &created = rings.emplace_back(std::make_unique<TraceRing>());
+      created->thread_index = static_cast<std::uint32_t>(rings.size());
+      return created.get();
+    }();
+    return *local;
+  }
+
+public:
+  static void enable() noexcept { active.store(true, std::memory_order_relaxed); }
+  [[nodiscard]] static bool enabled() noexcept { return active.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] static std::int64_t now_ns() noexcept
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+  }
+
+  static void record(const char *name, const std::int64_t start_ns, const std::int64_t end_ns)
+  {
+    if (!enabled()) { return; }
+    ring().push({ name, start_ns, end_ns - start_ns });
+  }
+
+  // Percentiles of the durations of the most recent events called `name`, over all threads.
+  static LatencyPercentiles percentiles(const char *name)
+  {
+    std::vector<std::int64_t> durations;
+    {
+      const std::lock_guard lock{ rings_mutex };
+      for (const auto &r : rings) {
+        r->for_each([&](const TraceEvent &event) {
+          if (std::strcmp(event.name, name) == 0) { durations.push_back(event.duration_ns); }
+        });
+      }
+    }
+    if (durations.empty()) { return {}; }
+
+    std::sort(durations.begin(), durations.end());
+    const auto at = [&](const double fraction) {
+      const auto index = static_cast<std::size_t>(fraction * static_cast<double>(durations.size() - 1));
+      return static_cast<double>(durations[index]) / 1e6;
+    };
+    return { durations.size(), at(0.50), at(0.95), at(0.99) };
+  }
+
+  // Chrome trace-event format, viewable in chrome://tracing or Perfetto.
+  static void write_chrome_json(const std::string &path)
+  {
+    std::ofstream file{ path };
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    const auto separator = [&] {
+      if (!first) { file << ",\n"; }
+      first = false;
+    };
+
+    const std::lock_guard lock{ rings_mutex };
+    for (const auto &r : rings) {
+      separator();
+      file << fmt::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"thread {}"}}}})",
+        r->thread_index,
+        r->thread_index);
+      r->for_each([&](const TraceEvent &event) {
+        separator();
+        file << fmt::format(R"({{"name":"{}","cat":"consu","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})",
+          event.name,
+          r->thread_index,
+          static_cast<double>(event.start_ns) / 1e3,
+          static_cast<double>(event.duration_ns) / 1e3);
+      });
+    }
+    file << "]}\n";
+  }
+};
+
+// Records the time between its construction and destruction under `name`, which must be a string literal.
+class TraceScope
+{
+  const char *name;
+  std::int64_t start_ns;
+
+public:
+  explicit TraceScope(const char *scope_name) noexcept
+    : name{ Trace::enabled() ? scope_name : nullptr }, start_ns{ name != nullptr ? Trace::now_ns() : 0 }
+  {}
+  ~TraceScope()
+  {
+    if (name != nullptr) { Trace::record(name, start_ns, Trace::now_ns()); }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+  TraceScope(TraceScope &&) = delete;
+  TraceScope &operator=(TraceScope &&) = delete;
+};
+
+#define CONSU_TRACE_CONCAT_INNER(a, b) a##b
+#define CONSU_TRACE_CONCAT(a, b) CONSU_TRACE_CONCAT_INNER(a, b)
+#ifdef CONSU_DISABLE_TRACING
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) const TraceScope CONSU_TRACE_CONCAT(trace_scope_, __LINE__){ name }
+#endif
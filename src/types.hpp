@@ -3,23 +3,40 @@
 #include <vector>
 #include <atomic>
 
+#include "note_track.hpp"
+
+enum class PlaybackMode {
+  // stream long WAV tracks, fully decode everything else
+  Auto,
+  Buffered,
+  Streaming
+};
+
+enum class OutputMode {
+  // re-emit the whole screen every frame
+  Full,
+  // emit only the cells that changed since the previous frame
+  Damage
+};
+
 struct Points
 {
   std::size_t point;
   const char *msg;
 };
 
-struct Note
+// Left click stamped with the song time at which it was captured.
+struct TimedClick
 {
   int x;
   int y;
-  long long timestamp;
+  long long time_ms;
 };
 
 struct Song
 {
   std::string name;
-  std::vector<Note> notes;
+  NoteTrack notes;
 };
 
 struct Score
@@ -28,4 +45,6 @@ struct Score
   std::size_t points = 0;
   std::size_t combo = 0;
   std::size_t max_combo = 0;
+
+  bool operator==(const Score &) const = default;
 };
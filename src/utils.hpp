@@ -3,8 +3,18 @@
 #include <ftxui/screen/color.hpp>
 #include <fmt/format.h>
 
+#include <array>
+
 #include "constants.hpp"
 
+// Every color time_to_color can return.
+static constexpr std::array<ftxui::Color::Palette256, 7> NOTE_COLORS{ ftxui::Color::Blue1,
+  ftxui::Color::Green1,
+  ftxui::Color::Yellow1,
+  ftxui::Color::DarkOrange,
+  ftxui::Color::OrangeRed1,
+  ftxui::Color::Red3,
+  ftxui::Color::Red1 };
 
 static constexpr ftxui::Color::Palette256 time_to_color(const long long time_ms) noexcept
 {
@@ -17,7 +27,7 @@ static constexpr ftxui::Color::Palette256 time_to_color(const long long time_ms)
   return ftxui::Color::Red1;
 }
 
-static Points time_to_points(const long long time_ms) noexcept
+static constexpr Points time_to_points(const long long time_ms) noexcept
 {
   if (time_ms > TIME_CONSTANTS::NOTE_MISS) return POINT_CONSTANTS::MISS;
   if (time_ms > TIME_CONSTANTS::NOTE_OK) return POINT_CONSTANTS::OK;
@@ -26,11 +36,15 @@ static Points time_to_points(const long long time_ms) noexcept
   return POINT_CONSTANTS::PERFECT;
 }
 
-static std::string generate_folder_path(const std::string &file_name)
+inline std::string generate_folder_path(const std::string &file_name)
 {
   return fmt::format("{}/{}", FILE_CONSTANTS::FOLDER_PATH, file_name);
 }
-static std::string generate_map_path(const std::string& file_name)
+inline std::string generate_map_path(const std::string& file_name)
 {
   return fmt::format("{}/{}/{}{}", FILE_CONSTANTS::FOLDER_PATH, file_name, file_name, FILE_CONSTANTS::GAMEFILE_EXT);
 }
+inline std::string generate_journal_path(const std::string &file_name)
+{
+  return fmt::format("{}/{}/{}{}", FILE_CONSTANTS::FOLDER_PATH, file_name, file_name, FILE_CONSTANTS::JOURNAL_EXT);
+}
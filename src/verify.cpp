@@ -0,0 +1,101 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "replay.hpp"
+#include "song.hpp"
+#include "thread_pool.hpp"
+
+// Re-scores recorded replays headlessly against the current judgement rules and reports every replay whose
+// stored score differs.
+// Usage: consu_verify [replay file or folder...] - checks everything in replays/ when no path is given.
+int main(int argc, char *argv[])
+{
+  try {
+    const auto args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+    std::vector<std::string> roots(args.begin(), args.end());
+    if (roots.empty()) { roots.emplace_back(FILE_CONSTANTS::REPLAY_FOLDER); }
+
+    std::vector<std::string> paths;
+    for (const auto &root : roots) {
+      if (std::filesystem::is_regular_file(root)) {
+        paths.push_back(root);
+        continue;
+      }
+      if (!std::filesystem::is_directory(root)) {
+        fmt::print("{}: not found, skipped\n", root);
+        continue;
+      }
+      for (const auto &entry : std::filesystem::recursive_directory_iterator{ root }) {
+        if (entry.is_regular_file() && entry.path().extension() == FILE_CONSTANTS::REPLAY_EXT) {
+          paths.push_back(entry.path().string());
+        }
+      }
+    }
+
+    ThreadPool pool;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Replay> replays(paths.size());
+    pool.for_each_index(paths.size(), [&](std::size_t i) { replays[i] = load_replay(paths[i]); });
+
+    // every map is loaded once, however many replays were recorded on it
+    std::vector<std::string> stems;
+    for (const auto &replay : replays) {
+      if (!replay.stem.empty()) { stems.push_back(replay.stem); }
+    }
+    std::sort(stems.begin(), stems.end());
+    stems.erase(std::unique(stems.begin(), stems.end()), stems.end());
+    std::vector<Song> songs(stems.size());
+    pool.for_each_index(stems.size(), [&](std::size_t i) {
+      if (std::filesystem::exists(generate_map_path(stems[i]))) { songs[i] = load_song_from_disk(stems[i]); }
+    });
+    const auto loaded = std::chrono::steady_clock::now();
+
+    std::vector<Score> rescored(replays.size());
+    pool.for_each_index(replays.size(), [&](std::size_t i) {
+      if (replays[i].stem.empty()) { return; }
+      const auto song = std::lower_bound(stems.begin(), stems.end(), replays[i].stem) - stems.begin();
+      rescored[i] = score_replay(songs[static_cast<std::size_t>(song)].notes, replays[i]);
+    });
+    const auto scored = std::chrono::steady_clock::now();
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < replays.size(); ++i) {
+      const auto &replay = replays[i];
+      if (replay.stem.empty()) {
+        fmt::print("{}: unreadable replay\n", paths[i]);
+        ++mismatches;
+      } else if (rescored[i] != replay.score) {
+        fmt::print("{}: recorded {} points ({} notes, max combo {}), rescored {} points ({} notes, max combo {})\n",
+          paths[i],
+          replay.score.points,
+          replay.score.note_no,
+          replay.score.max_combo,
+          rescored[i].points,
+          rescored[i].note_no,
+          rescored[i].max_combo);
+        ++mismatches;
+      }
+    }
+
+    const std::chrono::duration<double> load_time = loaded - start;
+    const std::chrono::duration<double> score_time = scored - loaded;
+    fmt::print("Verified {} replays on {} threads: {} mismatches (load {:.3f} s, scoring {:.3f} s, {:.0f} replays/s)\n",
+      replays.size(),
+      pool.size(),
+      mismatches,
+      load_time.count(),
+      score_time.count(),
+      score_time.count() > 0 ? static_cast<double>(replays.size()) / score_time.count() : 0.0);
+    return mismatches == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    fmt::print("Unhandled exception in main: {}", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <ftxui/component/component.hpp>
+#include <ftxui/component/component_base.hpp>
+#include <ftxui/component/event.hpp>
+#include <ftxui/component/mouse.hpp>
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/screen/box.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "constants.hpp"
+
+// Scrollable list that only asks for and lays out the rows inside its viewport, so building and drawing it
+// costs the same for ten items or a hundred thousand.
+class VirtualList : public ftxui::ComponentBase
+{
+public:
+  using Size = std::function<std::size_t()>;
+  using Label = std::function<std::string(std::size_t)>;
+  using Callback = std::function<void(std::size_t)>;
+
+private:
+  Size size;
+  Label label;
+  Callback on_select;
+  Callback on_highlight;
+
+  std::size_t selected = 0;
+  std::size_t first_row = 0;
+  std::size_t highlighted = static_cast<std::size_t>(-1);
+  ftxui::Box box;
+
+  static constexpr std::size_t ROWS = MENU_CONSTANTS::SONG_LIST_ROWS;
+
+  void clamp()
+  {
+    const auto count = size();
+    selected = count == 0 ? 0 : std::min(selected, count - 1);
+    if (selected < first_row) { first_row = selected; }
+    if (selected >= first_row + ROWS) { first_row = selected - ROWS + 1; }
+    first_row = std::min(first_row, count > ROWS ? count - ROWS : 0);
+  }
+
+  void move(const long long delta)
+  {
+    const auto count = static_cast<long long>(size());
+    if (count == 0) { return; }
+    selected = static_cast<std::size_t>(std::clamp(static_cast<long long>(selected) + delta, 0LL, count - 1));
+    clamp();
+  }
+
+  bool on_mouse(ftxui::Event &event)
+  {
+    auto &mouse = event.mouse();
+    if (!box.Contain(mouse.x, mouse.y)) { return false; }
+    if (mouse.button == ftxui::Mouse::WheelUp) {
+      move(-1);
+      return true;
+    }
+    if (mouse.button == ftxui::Mouse::WheelDown) {
+      move(1);
+      return true;
+    }
+    if (mouse.button == ftxui::Mouse::Left && mouse.motion == ftxui::Mouse::Pressed) {
+      const auto row = first_row + static_cast<std::size_t>(mouse.y - box.y_min);
+      if (row >= size()) { return false; }
+      TakeFocus();
+      selected = row;
+      on_select(selected);
+      return true;
+    }
+    return false;
+  }
+
+public:
+  VirtualList(Size item_count, Label item_label, Callback select, Callback highlight)
+    : size{ std::move(item_count) }, label{ std::move(item_label) }, on_select{ std::move(select) },
+      on_highlight{ std::move(highlight) }
+  {}
+
+  ftxui::Element Render() override
+  {
+    clamp();
+    const auto count = size();
+    const bool focused = Focused();
+    if (focused && count > 0 && highlighted != selected) {
+      highlighted = selected;
+      on_highlight(selected);
+    }
+
+    // thumb of the scroll bar, proportional to the visible share of the list
+    const auto thumb_size = count > ROWS ? std::max<std::size_t>(1, ROWS * ROWS / count) : ROWS;
+    const auto thumb_start = count > ROWS ? first_row * (ROWS - thumb_size) / (count - ROWS) : 0;
+
+    ftxui::Elements rows;
+    rows.reserve(ROWS);
+    for (std::size_t row = 0; row < ROWS; ++row) {
+      const auto index = first_row + row;
+      auto item = index < count ? ftxui::text(label(index)) : ftxui::text("");
+      if (index == selected && index < count) {
+        item = focused ? item | ftxui::inverted | ftxui::focus : item | ftxui::select;
+      }
+      const bool thumb = count > ROWS && row >= thumb_start && row < thumb_start + thumb_size;
+      rows.push_back(ftxui::hbox({ item | ftxui::flex, ftxui::text(thumb ? "┃" : " ") }));
+    }
+    return ftxui::vbox(std::move(rows)) | ftxui::reflect(box);
+  }
+
+  bool OnEvent(ftxui::Event event) override
+  {
+    if (event.is_mouse()) { return on_mouse(event); }
+    if (!Focused()) { return false; }
+
+    if (event == ftxui::Event::ArrowUp || event == ftxui::Event::Character('k')) {
+      move(-1);
+    } else if (event == ftxui::Event::ArrowDown || event == ftxui::Event::Character('j')) {
+      move(1);
+    } else if (event == ftxui::Event::PageUp) {
+      move(-static_cast<long long>(ROWS));
+    } else if (event == ftxui::Event::PageDown) {
+      move(static_cast<long long>(ROWS));
+    } else if (event == ftxui::Event::Home) {
+      move(-static_cast<long long>(size()));
+    } else if (event == ftxui::Event::End) {
+      move(static_cast<long long>(size()));
+    } else if (event == ftxui::Event::Return && size() > 0) {
+      on_select(selected);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool Focusable() const override { return true; }
+};
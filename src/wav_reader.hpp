@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+// Incremental reader of RIFF/WAVE files. Samples are converted to interleaved 16-bit PCM as they are read,
+// so only the requested chunk is ever held in memory. Supports 8/16/24/32-bit integer and 32-bit float data.
+class WavReader
+{
+  static constexpr std::uint16_t FORMAT_PCM = 1;
+  static constexpr std::uint16_t FORMAT_FLOAT = 3;
+  static constexpr std::uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+  std::ifstream file;
+  std::uint16_t format = 0;
+  std::uint16_t channel_count = 0;
+  std::uint32_t rate = 0;
+  std::uint16_t bits = 0;
+  std::uint64_t total_frames = 0;
+  std::uint64_t frames_left = 0;
+  std::vector<char> scratch;
+
+  template<typename T> T read_value()
+  {
+    T value{};
+    file.read(reinterpret_cast<char *>(&value), sizeof(value));// NOLINT
+    return value;
+  }
+
+  [[nodiscard]] std::size_t bytes_per_sample() const noexcept { return bits / 8U; }
+
+  [[nodiscard]] std::int16_t convert(const char *sample) const noexcept
+  {
+    switch (bits) {
+    case 8:
+      return static_cast<std::int16_t>((static_cast<int>(static_cast<unsigned char>(*sample)) - 128) * 256);
+    case 16: {
+      std::int16_t value{};
+      std::memcpy(&value, sample, sizeof(value));
+      return value;
+    }
+    case 24: {
+      std::int16_t value{};
+      std::memcpy(&value, sample + 1, sizeof(value));
+      return value;
+    }
+    default:
+      break;
+    }
+    if (format == FORMAT_FLOAT) {
+      float value{};
+      std::memcpy(&value, sample, sizeof(value));
+      return static_cast<std::int16_t>(std::clamp(value, -1.0F, 1.0F) * 32767.0F);
+    }
+    std::int32_t value{};
+    std::memcpy(&value, sample, sizeof(value));
+    return static_cast<std::int16_t>(value / 65536);
+  }
+
+public:
+  explicit WavReader(const std::string &path) : file{ path, std::ios::binary }
+  {
+    std::array<char, 4> id{};
+    file.read(id.data(), id.size());
+    read_value<std::uint32_t>();
+    if (!file || std::memcmp(id.data(), "RIFF", id.size()) != 0) { return; }
+    file.read(id.data(), id.size());
+    if (!file || std::memcmp(id.data(), "WAVE", id.size()) != 0) { return; }
+
+    while (file.read(id.data(), id.size())) {
+      const auto chunk_size = read_value<std::uint32_t>();
+      if (std::memcmp(id.data(), "fmt ", id.size()) == 0) {
+        format = read_value<std::uint16_t>();
+        channel_count = read_value<std::uint16_t>();
+        rate = read_value<std::uint32_t>();
+        read_value<std::uint32_t>();
+        read_value<std::uint16_t>();
+        bits = read_value<std::uint16_t>();
+        if (format == FORMAT_EXTENSIBLE && chunk_size >= 26) {
+          read_value<std::uint16_t>();
+          read_value<std::uint16_t>();
+          read_value<std::uint32_t>();
+          format = read_value<std::uint16_t>();
+          file.seekg(chunk_size - 26, std::ios::cur);
+        } else {
+          file.seekg(chunk_size - 16, std::ios::cur);
+        }
+      } else if (std::memcmp(id.data(), "data", id.size()) == 0) {
+        if (channel_count == 0 || bits == 0) { return; }
+        total_frames = chunk_size / (bytes_per_sample() * channel_count);
+        frames_left = total_frames;
+        return;
+      } else {
+        file.seekg(chunk_size + (chunk_size & 1U), std::ios::cur);
+      }
+    }
+  }
+
+  [[nodiscard]] bool is_open() const noexcept
+  {
+    const bool supported_format = (format == FORMAT_PCM && (bits == 8 || bits == 16 || bits == 24 || bits == 32))
+                                  || (format == FORMAT_FLOAT && bits == 32);
+    return supported_format && (channel_count == 1 || channel_count == 2) && rate > 0 && total_frames > 0;
+  }
+  [[nodiscard]] int channels() const noexcept { return channel_count; }
+  [[nodiscard]] int sample_rate() const noexcept { return static_cast<int>(rate); }
+  [[nodiscard]] std::uint64_t frames() const noexcept { return total_frames; }
+
+  // Fills `out` with whole interleaved frames and returns how many frames were read; 0 at the end of the data.
+  std::size_t read(std::span<std::int16_t> out)
+  {
+    const auto frame_bytes = bytes_per_sample() * channel_count;
+    const auto frames = static_cast<std::size_t>(std::min<std::uint64_t>(frames_left, out.size() / channel_count));
+    scratch.resize(frames * frame_bytes);
+    file.read(scratch.data(), static_cast<std::streamsize>(scratch.size()));
+    const auto read_frames = static_cast<std::size_t>(file.gcount()) / frame_bytes;
+
+    for (std::size_t i = 0; i < read_frames * channel_count; ++i) {
+      out[i] = convert(&scratch[i * bytes_per_sample()]);
+    }
+    frames_left = read_frames == frames ? frames_left - frames : 0;
+    return read_frames;
+  }
+};
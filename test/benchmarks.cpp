@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/screen/screen.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "judge.hpp"
+#include "leaderboard.hpp"
+#include "onset_detector.hpp"
+#include "play_field.hpp"
+#include "scoped_working_dir.hpp"
+#include "song.hpp"
+#include "song_search.hpp"
+#include "synthetic_audio.hpp"
+#include "synthetic_map.hpp"
+#include "utils.hpp"
+
+// Run with `benchmarks -r xml` (or the run_benchmarks target) to keep machine-readable results per release.
+
+TEST_CASE("Map save and load", "[!benchmark][song]")
+{
+  const ScopedWorkingDir dir{ "consu_benchmarks_song" };
+
+  for (const std::size_t note_count : std::array<std::size_t, 4>{ 1'000, 10'000, 100'000, 1'000'000 }) {
+    const auto song = make_synthetic_song(fmt::format("synthetic_{}", note_count), note_count);
+    std::filesystem::create_directories(generate_folder_path(song.name));
+
+    for (const auto &[format, name] : { std::pair{ MapFormat::Packed, "packed" },
+           std::pair{ MapFormat::Binary, "binary" },
+           std::pair{ MapFormat::Text, "text" } }) {
+      const auto suffix = fmt::format("{} notes, {}", note_count, name);
+      BENCHMARK(fmt::format("save_song_to_disk {}", suffix)) { save_song_to_disk(song, format); };
+      BENCHMARK(fmt::format("load_song_from_disk {}", suffix)) { return load_song_from_disk(song.name); };
+    }
+
+    // decoding alone, from memory, without the file system
+    std::vector<char> packed;
+    pack_notes(song.notes, packed);
+    BENCHMARK(fmt::format("unpack_notes {} notes", note_count))
+    {
+      NoteTrack notes;
+      unpack_notes(reinterpret_cast<const std::byte *>(packed.data()), packed.size(), song.notes.size(), notes);
+      return notes.size();
+    };
+  }
+}
+
+TEST_CASE("Hit timing", "[!benchmark][utils]")
+{
+  // the sweep covers every bucket; its result is returned so the calls cannot be optimized out
+  BENCHMARK("time_to_points sweep")
+  {
+    std::size_t points = 0;
+    for (long long t = -500; t <= 1500; ++t) { points += time_to_points(t).point; }
+    return points;
+  };
+  BENCHMARK("time_to_color sweep")
+  {
+    int colors = 0;
+    for (long long t = -500; t <= 1500; ++t) { colors += static_cast<int>(time_to_color(t)); }
+    return colors;
+  };
+}
+
+TEST_CASE("Hit test", "[!benchmark][judge]")
+{
+  const auto song = make_synthetic_song("synthetic", 100'000);
+  BENCHMARK("judge every note of 100k")
+  {
+    Judge judge{ song.notes };
+    for (const auto note : song.notes) { judge.click({ note.x, note.y, note.timestamp }); }
+    return judge.current_score();
+  };
+}
+
+TEST_CASE("Map generation", "[!benchmark][generate]")
+{
+  const ScopedWorkingDir dir{ "consu_benchmarks_generate" };
+  std::vector<long long> hits;
+  for (long long time = 500; time < 299'500; time += 300) { hits.push_back(time); }
+  write_click_track("track.wav", hits, 300.0);
+
+  BENCHMARK("detect_onsets 5-minute track") { return detect_onsets("track.wav"); };
+}
+
+TEST_CASE("Play frame", "[!benchmark][play_field]")
+{
+  const auto song = make_synthetic_song("synthetic", 10'000);
+  PlayField play_field;
+  const Score score{ 42, 12'345, 17, 30 };
+  auto screen = ftxui::Screen::Create(ftxui::Dimension::Fixed(120), ftxui::Dimension::Fixed(40));
+
+  long long time_ms = 0;
+  JudgedNotes judged;
+  const auto next_frame = [&] {
+    time_ms += 8;
+    judged.first_unjudged = song.notes.first_at_or_after(time_ms);
+    play_field.update(song.notes, judged, time_ms);
+    return ftxui::hbox(
+      { play_field.render(), play_sidebar(song.name, score, POINT_CONSTANTS::PERFECT_TXT, ftxui::emptyElement()) });
+  };
+
+  BENCHMARK("play frame element tree") { return next_frame(); };
+  BENCHMARK("play frame element tree and render")
+  {
+    ftxui::Render(screen, next_frame());
+    return screen.ToString().size();
+  };
+}
+
+TEST_CASE("Song list scan", "[!benchmark][song]")
+{
+  const ScopedWorkingDir dir{ "consu_benchmarks_library" };
+  for (int i = 0; i < 1000; ++i) {
+    std::filesystem::create_directories(generate_folder_path(fmt::format("song_{}", i)));
+  }
+
+  BENCHMARK("get_songs_list 1000 songs") { return get_songs_list(); };
+}
+
+TEST_CASE("Song search", "[!benchmark][search]")
+{
+  std::vector<LibraryEntry> songs;
+  for (std::size_t i = 0; i < 100'000; ++i) {
+    songs.push_back({ fmt::format("{}_song_{:06}", i % 7 == 0 ? "moonlight" : "sunset", i), "", "", 0, 0, {} });
+  }
+  std::sort(songs.begin(), songs.end(), [](const auto &lhs, const auto &rhs) { return lhs.stem < rhs.stem; });
+
+  SongSearchIndex index;
+  BENCHMARK("build index 100k songs") { index.build(songs); };
+  index.build(songs);
+
+  BENCHMARK("fresh query 100k songs")
+  {
+    index.search("");
+    return index.search("moonl").size();
+  };
+  BENCHMARK("typing 'moon 42' keystroke by keystroke 100k songs")
+  {
+    index.search("");
+    const std::string query = "moon 42";
+    std::size_t results = 0;
+    for (std::size_t length = 1; length <= query.size(); ++length) {
+      results += index.search(query.substr(0, length)).size();
+    }
+    return results;
+  };
+}
+
+TEST_CASE("Leaderboard", "[!benchmark][leaderboard]")
+{
+  const ScopedWorkingDir dir{ "consu_benchmarks_leaderboard" };
+  constexpr std::size_t plays = 2'000'000;
+  constexpr std::size_t songs = 1'000;
+  {
+    std::ofstream log{ FILE_CONSTANTS::SCORE_LOG, std::ios::binary };
+    const ScoreLogHeader header{ SCORE_CONSTANTS::LOG_MAGIC, SCORE_CONSTANTS::VERSION, 0 };
+    log.write(reinterpret_cast<const char *>(&header), sizeof(header));// NOLINT
+    for (std::size_t i = 0; i < plays; ++i) {
+      const ScoreRecord record{ score_song_key(fmt::format("song_{}", i % songs)),
+        { i * 7919 % 100'000, static_cast<std::int64_t>(i), 0, 0 } };
+      log.write(reinterpret_cast<const char *>(&record), sizeof(record));// NOLINT
+    }
+  }
+
+  BENCHMARK("compact 2M plays from scratch")
+  {
+    std::filesystem::remove(FILE_CONSTANTS::SCORE_INDEX);
+    return compact_scores(FILE_CONSTANTS::SCORE_LOG, FILE_CONSTANTS::SCORE_INDEX);
+  };
+
+  Leaderboard board;
+  board.load();
+  std::uint64_t points = 0;
+  BENCHMARK("rank query 2M plays")
+  {
+    points = (points + 7919) % 100'000;
+    return board.rank("song_42", points);
+  };
+  BENCHMARK("top 5 query 2M plays") { return board.top("song_42", 5); };
+}
@@ -1,14 +1,27 @@
 #include <catch2/catch.hpp>
 
-constexpr unsigned int Factorial(unsigned int number)// NOLINT(misc-no-recursion)
+#include <string_view>
+
+#include "utils.hpp"
+
+TEST_CASE("Hit timing maps to points with constexpr", "[time_to_points]")
 {
-  return number <= 1 ? number : Factorial(number - 1) * number;
+  STATIC_REQUIRE(time_to_points(TIME_CONSTANTS::NOTE_MISS + 1).point == POINT_CONSTANTS::MISS.point);
+  STATIC_REQUIRE(time_to_points(TIME_CONSTANTS::NOTE_MISS).point == POINT_CONSTANTS::OK.point);
+  STATIC_REQUIRE(time_to_points(TIME_CONSTANTS::NOTE_OK).point == POINT_CONSTANTS::NICE.point);
+  STATIC_REQUIRE(time_to_points(TIME_CONSTANTS::NOTE_NICE).point == POINT_CONSTANTS::GOOD.point);
+  STATIC_REQUIRE(time_to_points(TIME_CONSTANTS::NOTE_GOOD).point == POINT_CONSTANTS::PERFECT.point);
+  STATIC_REQUIRE(time_to_points(0).point == POINT_CONSTANTS::PERFECT.point);
+  STATIC_REQUIRE(std::string_view{ time_to_points(0).msg } == POINT_CONSTANTS::PERFECT_TXT);
 }
 
-TEST_CASE("Factorials are computed with constexpr", "[factorial]")
+TEST_CASE("Note color follows the time left with constexpr", "[time_to_color]")
 {
-  STATIC_REQUIRE(Factorial(1) == 1);
-  STATIC_REQUIRE(Factorial(2) == 2);
-  STATIC_REQUIRE(Factorial(3) == 6);
-  STATIC_REQUIRE(Factorial(10) == 3628800);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::MAX_TIME_DISPLAY_NOTE + 1) == ftxui::Color::Blue1);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::MAX_TIME_DISPLAY_NOTE) == ftxui::Color::Green1);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::TIME_PREP) == ftxui::Color::Yellow1);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::NOTE_MISS) == ftxui::Color::DarkOrange);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::NOTE_OK) == ftxui::Color::OrangeRed1);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::NOTE_NICE) == ftxui::Color::Red3);
+  STATIC_REQUIRE(time_to_color(TIME_CONSTANTS::NOTE_GOOD) == ftxui::Color::Red1);
 }
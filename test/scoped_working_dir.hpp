@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// Runs the enclosed code in a fresh temporary directory, so relative paths such as songs/ never touch the
+// real library.
+class ScopedWorkingDir
+{
+  std::filesystem::path previous = std::filesystem::current_path();
+  std::filesystem::path directory;
+
+public:
+  explicit ScopedWorkingDir(const std::string &name)
+    : directory{ std::filesystem::temp_directory_path() / name }
+  {
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::filesystem::current_path(directory);
+  }
+  ~ScopedWorkingDir()
+  {
+    std::filesystem::current_path(previous);
+    std::filesystem::remove_all(directory);
+  }
+
+  ScopedWorkingDir(const ScopedWorkingDir &) = delete;
+  ScopedWorkingDir &operator=(const ScopedWorkingDir &) = delete;
+  ScopedWorkingDir(ScopedWorkingDir &&) = delete;
+  ScopedWorkingDir &operator=(ScopedWorkingDir &&) = delete;
+};
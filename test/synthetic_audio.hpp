@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Writes a 16-bit stereo WAV of quiet noise with a decaying percussive hit at every time in `hits_ms`.
+void write_click_track(const std::string &path, const std::vector<long long> &hits_ms, const double seconds)
+{
+  constexpr int rate = 44100;
+  constexpr int channels = 2;
+  const auto frames = static_cast<std::size_t>(seconds * rate);
+  std::vector<float> mono(frames);
+
+  std::mt19937 rng{ 7 };
+  std::normal_distribution<float> noise{ 0.0F, 1.0F };
+  for (auto &sample : mono) { sample = 0.01F * noise(rng); }
+  for (const auto hit : hits_ms) {
+    const auto start = static_cast<std::size_t>(hit * rate / 1000);
+    for (std::size_t i = 0; i < 4000 && start + i < frames; ++i) {
+      const auto t = static_cast<float>(i);
+      mono[start + i] += 0.5F * std::exp(-t / 800.0F) * (std::sin(t * 0.3F) + 0.5F * noise(rng));
+    }
+  }
+
+  std::vector<std::int16_t> samples;
+  samples.reserve(frames * channels);
+  for (const auto sample : mono) {
+    const auto value = static_cast<std::int16_t>(std::clamp(sample, -1.0F, 1.0F) * 32767.0F);
+    samples.insert(samples.end(), channels, value);
+  }
+
+  std::ofstream file{ path, std::ios::binary };
+  const auto write = [&](const auto value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));// NOLINT
+  };
+  const auto data_bytes = static_cast<std::uint32_t>(samples.size() * sizeof(std::int16_t));
+  file.write("RIFF", 4);
+  write(std::uint32_t{ 36 } + data_bytes);
+  file.write("WAVEfmt ", 8);
+  write(std::uint32_t{ 16 });
+  write(std::uint16_t{ 1 });
+  write(std::uint16_t{ channels });
+  write(std::uint32_t{ rate });
+  write(std::uint32_t{ rate * channels * 2 });
+  write(std::uint16_t{ channels * 2 });
+  write(std::uint16_t{ 16 });
+  file.write("data", 4);
+  write(data_bytes);
+  file.write(reinterpret_cast<const char *>(samples.data()), data_bytes);// NOLINT
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "constants.hpp"
+#include "types.hpp"
+
+// Deterministic map with notes spread over the whole play field, 50 to 400 ms apart.
+Song make_synthetic_song(const std::string &name, const std::size_t note_count, const std::uint32_t seed = 1)
+{
+  constexpr auto field_width = static_cast<int>(CANVAS_CONSTANTS::SIZE) / CANVAS_CONSTANTS::RATIO_FIX[0];
+  constexpr auto field_height = static_cast<int>(CANVAS_CONSTANTS::SIZE) / CANVAS_CONSTANTS::RATIO_FIX[1];
+
+  std::mt19937 rng{ seed };
+  std::uniform_int_distribution<int> x{ 0, field_width - 1 };
+  std::uniform_int_distribution<int> y{ 0, field_height - 1 };
+  std::uniform_int_distribution<long long> gap{ 50, 400 };
+
+  Song song{ name, {} };
+  song.notes.reserve(note_count);
+  long long timestamp = 1000;
+  for (std::size_t i = 0; i < note_count; ++i) {
+    song.notes.push_back({ x(rng), y(rng), timestamp });
+    timestamp += gap(rng);
+  }
+  return song;
+}
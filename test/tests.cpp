@@ -1,14 +1,512 @@
 #include <catch2/catch.hpp>
 
-unsigned int Factorial(unsigned int number)// NOLINT(misc-no-recursion)
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "frame_output.hpp"
+#include "judge.hpp"
+#include "leaderboard.hpp"
+#include "library_analysis.hpp"
+#include "map_stats.hpp"
+#include "map_journal.hpp"
+#include "onset_detector.hpp"
+#include "replay.hpp"
+#include "scoped_working_dir.hpp"
+#include "simulation.hpp"
+#include "song.hpp"
+#include "song_filter.hpp"
+#include "song_search.hpp"
+#include "spsc_queue.hpp"
+#include "synthetic_audio.hpp"
+#include "synthetic_map.hpp"
+
+namespace {
+bool same_notes(const NoteTrack &a, const NoteTrack &b)
+{
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Note &l, const Note &r) {
+    return l.x == r.x && l.y == r.y && l.timestamp == r.timestamp;
+  });
+}
+
+// Writes one frame the way FTXUI does and returns what reached the terminal.
+std::string draw(std::ostringstream &terminal, const std::string &frame)
+{
+  const auto written = terminal.str().size();
+  terminal << frame << std::flush;
+  return terminal.str().substr(written);
+}
+}// namespace
+
+TEST_CASE("Maps survive a save and load in every format", "[song]")
+{
+  const ScopedWorkingDir dir{ "consu_tests_song" };
+  const auto song = make_synthetic_song("synthetic", 1000);
+  std::filesystem::create_directories(generate_folder_path(song.name));
+
+  for (const auto format : { MapFormat::Text, MapFormat::Binary, MapFormat::Packed }) {
+    save_song_to_disk(song, format);
+    REQUIRE(detect_map_format(generate_map_path(song.name)) == format);
+    REQUIRE(read_note_count(generate_map_path(song.name)) == song.notes.size());
+
+    const auto loaded = load_song_from_disk(song.name);
+    REQUIRE(loaded.name == song.name);
+    REQUIRE(same_notes(loaded.notes, song.notes));
+  }
+}
+
+TEST_CASE("Packed notes round-trip at the edges of their types", "[song]")
+{
+  NoteTrack notes;
+  // a partial last block, negative and extreme values, and a time going backwards
+  for (int i = 0; i < 300; ++i) { notes.push_back({ i % 7 - 3, i * 97 % 40, i * 250LL }); }
+  notes.push_back({ -32768, 32767, 2'147'483'647 });
+  notes.push_back({ 32767, -32768, -2'147'483'648 });
+  notes.push_back({ 0, 0, 5 });
+
+  std::vector<char> packed;
+  pack_notes(notes, packed);
+  const auto *const data = reinterpret_cast<const std::byte *>(packed.data());
+  NoteTrack unpacked;
+  REQUIRE(unpack_notes(data, packed.size(), notes.size(), unpacked));
+  REQUIRE(same_notes(unpacked, notes));
+  REQUIRE_FALSE(unpack_notes(data, packed.size() - 1, notes.size(), unpacked));
+
+  // the vectorized decoder has to agree with the scalar one for every width
+  PackedColumn values{};
+  for (std::size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<std::uint32_t>(i * 2'654'435'761U); }
+  for (unsigned bits = 0; bits <= 32; ++bits) {
+    PackedColumn expected{};
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      expected[i] = bits == 32 ? values[i] : values[i] & ((1U << bits) - 1);
+    }
+    std::vector<std::uint32_t> words(packed_column_words(32));
+    pack_column(expected, bits, words.data());
+    PackedColumn scalar{};
+    unpack_column_scalar(words.data(), bits, scalar);
+    REQUIRE(scalar == expected);
+    PackedColumn dispatched{};
+    unpack_column(words.data(), bits, dispatched);
+    REQUIRE(dispatched == expected);
+  }
+  PackedColumn scalar_times = values;
+  PackedColumn dispatched_times = values;
+  decode_times_scalar(scalar_times, 12345);
+  decode_times(dispatched_times, 12345);
+  REQUIRE(scalar_times == dispatched_times);
+}
+
+TEST_CASE("Version 1 maps with packed notes still load", "[song]")
+{
+  const ScopedWorkingDir dir{ "consu_tests_song_v1" };
+  const auto song = make_synthetic_song("synthetic", 100);
+  std::filesystem::create_directories(generate_folder_path(song.name));
+
+  const MapHeader header{ BINARY_MAP_CONSTANTS::MAGIC,
+    BINARY_MAP_CONSTANTS::VERSION_PACKED_NOTES,
+    song.notes.size(),
+    static_cast<std::uint32_t>(song.name.size()),
+    0 };
+  std::vector<char> buffer(binary_notes_offset(song.name.size()) + song.notes.size() * sizeof(Note));
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  std::memcpy(buffer.data() + sizeof(header), song.name.data(), song.name.size());
+  for (std::size_t i = 0; i < song.notes.size(); ++i) {
+    const auto note = song.notes[i];
+    std::memcpy(buffer.data() + binary_notes_offset(song.name.size()) + i * sizeof(Note), &note, sizeof(Note));
+  }
+  std::ofstream{ generate_map_path(song.name), std::ios::binary }.write(
+    buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+  REQUIRE(same_notes(load_song_from_disk(song.name).notes, song.notes));
+}
+
+TEST_CASE("Interrupted mapping sessions are recovered from the journal", "[journal]")
+{
+  const ScopedWorkingDir dir{ "consu_tests_journal" };
+  const auto song = make_synthetic_song("synthetic", 500);
+  std::filesystem::create_directories(generate_folder_path(song.name));
+
+  {
+    MapJournal journal;
+    journal.start(song.name);
+    for (const auto note : song.notes) { REQUIRE(journal.append(note)); }
+    // leaving the scope without discard() is what a session cut short looks like on disk
+  }
+  // a record torn by the crash
+  std::ofstream{ generate_journal_path(song.name), std::ios::binary | std::ios::app }.write("\x01\x02\x03", 3);
+
+  REQUIRE(same_notes(load_journal(generate_journal_path(song.name)), song.notes));
+  REQUIRE(recover_journals() == 1);
+  REQUIRE_FALSE(std::filesystem::exists(generate_journal_path(song.name)));
+  REQUIRE(same_notes(load_song_from_disk(song.name).notes, song.notes));
+  REQUIRE(find_song(song.name).empty());
+}
+
+TEST_CASE("Note windows are found by time", "[song]")
+{
+  NoteTrack notes;
+  for (const long long time : { 100, 200, 200, 300, 500 }) { notes.push_back({ 1, 2, time }); }
+
+  REQUIRE(notes.first_at_or_after(0) == 0);
+  REQUIRE(notes.first_at_or_after(200) == 1);
+  REQUIRE(notes.first_at_or_after(501) == notes.size());
+  REQUIRE(notes.window(200, 300) == std::pair<std::size_t, std::size_t>{ 1, 4 });
+  REQUIRE(notes.window(301, 499).first == notes.window(301, 499).second);
+}
+
+TEST_CASE("Clicks judge the note under them, in any order", "[judge]")
+{
+  NoteTrack notes;
+  // a stack of notes on one spot, and a simultaneous note elsewhere
+  for (const long long time : { 1000, 1050, 1100 }) { notes.push_back({ 10, 10, time }); }
+  notes.push_back({ 60, 30, 1000 });
+
+  Judge judge{ notes };
+  judge.click({ 60, 30, 1000 });
+  REQUIRE(judge.judged_notes().contains(3));
+  REQUIRE_FALSE(judge.judged_notes().contains(0));
+
+  for (const long long time : { 1000, 1050, 1100 }) { judge.click({ 12, 9, time }); }
+  REQUIRE(judge.current_score().note_no == 4);
+  REQUIRE(judge.current_score().points == 4 * POINT_CONSTANTS::PERFECT.point);
+  REQUIRE(judge.current_score().max_combo == 4);
+  REQUIRE(judge.judged_notes().first_unjudged == notes.size());
+  REQUIRE(judge.judged_notes().ahead.empty());
+
+  Judge early{ notes };
+  REQUIRE(early.click({ 60, 30, 500 })->point == POINT_CONSTANTS::MISS.point);
+  REQUIRE_FALSE(early.click({ 0, 0, 1000 }).has_value());
+  REQUIRE(early.expire(2000) == 3);
+  REQUIRE(early.current_score() == Score{ 4, 0, 0, 0 });
+}
+
+TEST_CASE("Every push wakes the consumer of a notifying queue", "[queue]")
+{
+  NotifyingQueue<int, 16> queue;
+  std::atomic<int> consumed = 0;
+  std::thread consumer{ [&] {
+    while (queue.wait_and_drain([&](int) { ++consumed; })) {}
+  } };
+
+  // Bursts push while the consumer is still draining the previous item. A lost wakeup leaves the end of a burst
+  // queued until the next push, which only comes after the deadline.
+  int pushed = 0;
+  int late = 0;
+  for (int burst = 0; burst < 20'000 && late == 0; ++burst) {
+    for (int i = 0; i <= burst % 3; ++i) {
+      for (int spin = 0; spin < burst % 64; ++spin) { std::this_thread::yield(); }
+      if (queue.push(pushed + 1)) { ++pushed; }
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{ 100 };
+    while (consumed < pushed && std::chrono::steady_clock::now() < deadline) { std::this_thread::yield(); }
+    if (consumed < pushed) { late = pushed; }
+  }
+  queue.close();
+  consumer.join();
+  REQUIRE(late == 0);
+}
+
+TEST_CASE("A click captured before a tick is judged before that tick expires its note", "[simulation]")
+{
+  NoteTrack notes;
+  notes.push_back({ 10, 10, 1000 });
+  notes.push_back({ 40, 20, 1050 });
+  ClickQueue clicks;
+  std::atomic<long long> now = 990;
+  std::atomic<bool> ended = false;
+  std::atomic<bool> finished = false;
+  std::vector<std::size_t> judgements;
+  Simulation simulation{
+    notes,
+    clicks,
+    [&] { return now.load(); },
+    [&] { return ended.load(); },
+    [&] { finished = true; },
+    [&](const Points &points) { judgements.push_back(points.point); },
+  };
+  const auto wait_until = [](auto done) {
+    while (!done()) { std::this_thread::yield(); }
+  };
+
+  // stamped at 995, but only queued after a tick at 1100, past the note, has run
+  clicks.capture(10, 10, [&] {
+    now = 1100;
+    wait_until([&] { return simulation.snapshot().time_ms == 1100; });
+    return 995LL;
+  });
+  ended = true;
+  wait_until([&] { return finished.load(); });
+
+  const auto snapshot = simulation.snapshot();
+  REQUIRE(snapshot.score == Score{ 2, POINT_CONSTANTS::PERFECT.point, 0, 1 });
+  // the second note expired unhit and still gets its miss sound
+  REQUIRE(judgements == std::vector{ POINT_CONSTANTS::PERFECT.point, POINT_CONSTANTS::MISS.point });
+  REQUIRE(snapshot.score == score_replay(notes, Replay{ "", {}, snapshot.time_ms, simulation.clicks_judged() }));
+}
+
+TEST_CASE("Damage tracking writes only the cells that changed", "[output]")
+{
+  std::ostringstream terminal;
+  const FrameOutput output{ terminal, true };
+
+  // a 256-color cell, and a wide glyph followed by a narrow one
+  const std::string first = "\x1B[?25lab\x1B[38;5;21mc\x1B[39m\r\n漢x";
+  REQUIRE(draw(terminal, first) == first);
+  REQUIRE(output.stats().full_frames == 1);
+  REQUIRE(output.stats().last_frame_bytes == first.size());
+
+  // each frame starts by moving the cursor back to the first row
+  const std::string reset = "\r\x1B[1A";
+  const std::string second = reset + "aB\x1B[38;2;255;0;0mc\x1B[39m\r\n漢\x1B[41my\x1B[49m";
+  const std::string second_diff =
+    "\r\x1B[1A\x1B[1CB\x1B[0;38;2;255;0;0mc\r\x1B[1B\x1B[2C\x1B[0;41my\r\x1B[3C\x1B[0m";
+  REQUIRE(draw(terminal, second) == second_diff);
+  REQUIRE(output.stats().last_frame_bytes == second_diff.size());
+
+  const std::string third = reset + "aB\x1B[38;2;255;0;0mc\x1B[39m\r\n字\x1B[41my\x1B[49m";
+  REQUIRE(draw(terminal, third) == "\r字\x1B[1C");
+
+  // nothing changed: the cursor is still put back where the frame ends
+  REQUIRE(draw(terminal, third) == "\r\x1B[3C");
+
+  // a resize is forwarded as it is
+  const std::string resized = reset + "\x1B[2Kab\r\n\x1B[2Kcd\r\nef";
+  REQUIRE(draw(terminal, resized) == resized);
+  REQUIRE(output.stats().full_frames == 2);
+  REQUIRE(output.stats().frames == 5);
+  REQUIRE(output.stats().total_bytes == terminal.str().size());
+}
+
+TEST_CASE("Full output mode forwards every frame unchanged", "[output]")
+{
+  std::ostringstream terminal;
+  const FrameOutput output{ terminal, false };
+
+  const std::string first = "ab\x1B[38;5;21mc\x1B[39m\r\n漢x";
+  const std::string second = "\r\x1B[1A" + first;
+  REQUIRE(draw(terminal, first) == first);
+  REQUIRE(draw(terminal, second) == second);
+  REQUIRE(output.stats().last_frame_bytes == second.size());
+  REQUIRE(output.stats().total_bytes == first.size() + second.size());
+  REQUIRE(output.stats().frames == 2);
+  REQUIRE(output.stats().full_frames == 0);
+}
+
+TEST_CASE("Maps are generated at the onsets of the music", "[generate]")
+{
+  const ScopedWorkingDir dir{ "consu_tests_generate" };
+  std::vector<long long> hits;
+  for (long long time = 500; time < 9500; time += 300 + time * 7 % 250) { hits.push_back(time); }
+  std::filesystem::create_directories(generate_folder_path("clicks"));
+  write_click_track(generate_folder_path("clicks") + "/clicks.wav", hits, 10.0);
+
+  const auto song = generate_song("clicks");
+  REQUIRE(song.notes.size() == hits.size());
+  for (std::size_t i = 0; i < hits.size(); ++i) {
+    REQUIRE(std::abs(song.notes.time(i) - hits[i]) <= 30);
+    REQUIRE(song.notes.x(i) >= 0);
+    REQUIRE(song.notes.x(i) < static_cast<int>(CANVAS_CONSTANTS::SIZE) / CANVAS_CONSTANTS::RATIO_FIX[0]);
+    REQUIRE(song.notes.y(i) >= 0);
+    REQUIRE(song.notes.y(i) < static_cast<int>(CANVAS_CONSTANTS::SIZE) / CANVAS_CONSTANTS::RATIO_FIX[1]);
+  }
+}
+
+TEST_CASE("Float PCM is mixed down like 16-bit PCM", "[generate]")
+{
+  // stereo at twice the analysis rate: each analysis sample averages two channels of two frames
+  const std::vector<float> decoded{ 0.5F, 0.25F, -0.25F, 0.5F, 1.0F, 1.0F, 0.0F, 0.0F };
+  const std::vector<std::int16_t> pcm{ 16384, 8192, -8192, 16384, 32767, 32767, 0, 0 };
+  Downmix from_float{ 2, 2 * ONSET_CONSTANTS::ANALYSIS_RATE, 1.0F };
+  Downmix from_pcm{ 2, 2 * ONSET_CONSTANTS::ANALYSIS_RATE, 32768.0F };
+  REQUIRE(from_float.rate() == ONSET_CONSTANTS::ANALYSIS_RATE);
+
+  std::vector<float> mixed_float;
+  std::vector<float> mixed_pcm;
+  from_float.add(decoded.data(), decoded.size() / 2, mixed_float);
+  from_pcm.add(pcm.data(), pcm.size() / 2, mixed_pcm);
+  REQUIRE(mixed_float.size() == 2);
+  REQUIRE(mixed_float[0] == Approx(0.25F));
+  REQUIRE(mixed_float[1] == Approx(0.5F));
+  REQUIRE(mixed_pcm.size() == 2);
+  for (std::size_t i = 0; i < mixed_pcm.size(); ++i) { REQUIRE(mixed_pcm[i] == Approx(mixed_float[i]).margin(1e-4)); }
+}
+
+TEST_CASE("Replays rescore to the judged score", "[replay]")
+{
+  const auto song = make_synthetic_song("synthetic", 100);
+  Replay replay{ song.name, {}, song.notes.back().timestamp + 1, {} };
+  for (std::size_t i = 0; i < song.notes.size(); i += 2) {
+    const auto note = song.notes[i];
+    replay.clicks.push_back({ note.x, note.y, note.timestamp });
+  }
+
+  const auto score = score_replay(song.notes, replay);
+  REQUIRE(score.note_no == song.notes.size());
+  REQUIRE(score.points == song.notes.size() / 2 * POINT_CONSTANTS::PERFECT.point);
+  REQUIRE(score.max_combo == 1);
+
+  const ScopedWorkingDir dir{ "consu_tests_replay" };
+  replay.score = score;
+  REQUIRE(save_replay(replay, generate_replay_path(song.name, 1)));
+  const auto loaded = load_replay(generate_replay_path(song.name, 1));
+  REQUIRE(loaded.stem == replay.stem);
+  REQUIRE(loaded.score == score);
+  REQUIRE(score_replay(song.notes, loaded) == score);
+}
+
+TEST_CASE("The library picks up maps rewritten inside an existing song folder", "[library]")
 {
-  return number <= 1 ? number : Factorial(number - 1) * number;
+  const ScopedWorkingDir dir{ "consu_tests_library" };
+  auto song = make_synthetic_song("rewritten", 10);
+  std::filesystem::create_directories(generate_folder_path(song.name));
+  REQUIRE(save_song_to_disk(song));
+
+  SongLibrary library;
+  library.refresh();
+  REQUIRE(library.find(song.name)->note_count == 10);
+
+  // the songs folder itself does not change, so only the per-song check can notice this
+  const auto root_mtime = std::filesystem::last_write_time(FILE_CONSTANTS::FOLDER_PATH);
+  song = make_synthetic_song("rewritten", 20);
+  REQUIRE(save_song_to_disk(song));
+  std::filesystem::last_write_time(generate_map_path(song.name), root_mtime + std::chrono::seconds{ 1 });
+  REQUIRE(std::filesystem::last_write_time(FILE_CONSTANTS::FOLDER_PATH) == root_mtime);
+
+  const auto revision = library.revision();
+  library.refresh();
+  REQUIRE(library.find(song.name)->note_count == 20);
+  REQUIRE(library.revision() != revision);
+}
+
+TEST_CASE("A finished analysis pass is applied before the next one starts", "[library]")
+{
+  const ScopedWorkingDir dir{ "consu_tests_analysis" };
+  const auto song = make_synthetic_song("analysed", 100);
+  std::filesystem::create_directories(generate_folder_path(song.name));
+  REQUIRE(save_song_to_disk(song));
+
+  SongLibrary library;
+  library.refresh();
+  LibraryAnalysis analysis;
+  std::atomic<bool> finished = false;
+  analysis.start(library, [&] { finished = true; });
+  while (!finished) { std::this_thread::yield(); }
+
+  // the menu was left before the results were applied
+  const auto revision = library.stats_revision();
+  analysis.start(library, [] {});
+  REQUIRE(library.stats_revision() != revision);
+  REQUIRE(library.find(song.name)->stats.analyzed);
+  REQUIRE(library.find(song.name)->stats.note_count == 100);
+}
+
+TEST_CASE("Song search ranks prefix matches first and narrows incrementally", "[search]")
+{
+  const std::vector<LibraryEntry> songs{ { "another_moon", "", "", 0, 0, {} },
+    { "blue_moon", "track.ogg", "", 0, 0, {} },
+    { "honeymoon", "", "", 0, 0, {} },
+    { "moonlight", "", "", 0, 0, {} },
+    { "sunrise", "moon.wav", "", 0, 0, {} } };
+
+  SongSearchIndex index;
+  index.build(songs);
+  REQUIRE(index.search("").size() == songs.size());
+
+  const auto moon = index.search("Moon");
+  REQUIRE(moon == std::vector<std::uint32_t>{ 3, 0, 1, 4, 2 });
+
+  REQUIRE(index.search("moon b") == std::vector<std::uint32_t>{ 1 });
+  REQUIRE(index.search("moon").size() == moon.size());
+  REQUIRE(index.search("ogg").size() == 1);
+  REQUIRE(index.search("xyz").empty());
+
+  SongSearchIndex fresh;
+  fresh.build(songs);
+  REQUIRE(fresh.search("moon b") == std::vector<std::uint32_t>{ 1 });
+}
+
+TEST_CASE("Map stats measure length, density and jumps, and filter the song list", "[library]")
+{
+  NoteTrack notes;
+  // four notes in the first second, then one every second, alternating between two spots 30 canvas pixels apart
+  for (const long long time : { 0, 250, 500, 750, 2000, 3000 }) {
+    notes.push_back({ notes.size() % 2 == 0 ? 0 : 15, 0, time });
+  }
+  const auto stats = compute_map_stats(notes);
+  REQUIRE(stats.analyzed);
+  REQUIRE(stats.note_count == 6);
+  REQUIRE(stats.duration_ms == 3000);
+  REQUIRE(stats.peak_notes_per_second == 4);
+  REQUIRE(stats.average_jump == Approx(15.0 * CANVAS_CONSTANTS::RATIO_FIX[0]));
+
+  std::vector<LibraryEntry> songs(3);
+  songs[0].stats = stats;
+  songs[1].stats = stats;
+  songs[1].stats.duration_ms = 90'000;
+  songs[1].stats.peak_notes_per_second = 8;
+
+  const auto query = parse_song_query("moon  nps>=4 len<100");
+  REQUIRE(query.text == "moon");
+  REQUIRE(query.filters.size() == 2);
+  REQUIRE(parse_song_query("nps>x").text == "nps>x");
+
+  std::vector<std::uint32_t> shown;
+  filter_and_sort(songs, { 2, 1, 0 }, query, SongSort::Relevance, shown);
+  REQUIRE(shown == std::vector<std::uint32_t>{ 1, 0 });
+  filter_and_sort(songs, { 2, 1, 0 }, parse_song_query("nps>4"), SongSort::Relevance, shown);
+  REQUIRE(shown == std::vector<std::uint32_t>{ 1 });
+  filter_and_sort(songs, { 2, 1, 0 }, {}, SongSort::Length, shown);
+  REQUIRE(shown == std::vector<std::uint32_t>{ 0, 1, 2 });
 }
 
-TEST_CASE("Factorials are computed", "[factorial]")
+TEST_CASE("Leaderboard ranks plays across the compacted index and the log", "[leaderboard]")
 {
-  REQUIRE(Factorial(1) == 1);
-  REQUIRE(Factorial(2) == 2);
-  REQUIRE(Factorial(3) == 6);
-  REQUIRE(Factorial(10) == 3628800);
+  const ScopedWorkingDir dir{ "consu_tests_leaderboard" };
+  {
+    Leaderboard board;
+    board.load();
+    for (std::size_t i = 0; i < 20; ++i) {
+      REQUIRE(board.add("moon", { 0, i * 100, 0, i }, static_cast<std::int64_t>(i)));
+    }
+    REQUIRE(board.add("sun", { 0, 5000, 0, 1 }, 0));
+    board.compact();
+    REQUIRE(board.add("moon", { 0, 1050, 0, 3 }, 100));
+    REQUIRE(board.add("moon", { 0, 1900, 0, 4 }, 101));
+
+    REQUIRE(board.count("moon") == 22);
+    REQUIRE(board.count("sun") == 1);
+    REQUIRE(board.count("star") == 0);
+    REQUIRE(board.rank("moon", 5000) == 1);
+    REQUIRE(board.rank("moon", 1900) == 1);
+    REQUIRE(board.rank("moon", 1000) == 12);
+    REQUIRE(board.rank("star", 10) == 1);
+
+    const auto best = board.top("moon", 3);
+    REQUIRE(best.size() == 3);
+    REQUIRE(best[0].points == 1900);
+    REQUIRE(best[0].recorded_at_ms == 19);
+    REQUIRE(best[1].recorded_at_ms == 101);
+    REQUIRE(best[2].points == 1800);
+  }
+
+  // a torn last record is dropped and later plays still line up
+  std::ofstream{ FILE_CONSTANTS::SCORE_LOG, std::ios::binary | std::ios::app } << "torn";
+  Leaderboard board;
+  board.load();
+  REQUIRE(board.count("moon") == 22);
+  REQUIRE(board.add("moon", { 0, 7000, 0, 1 }, 200));
+  board.compact();
+  REQUIRE(board.count("moon") == 23);
+  REQUIRE(board.top("moon", 1)[0].points == 7000);
+  REQUIRE(board.top("sun", 5).size() == 1);
 }